@@ -0,0 +1,75 @@
+#if !defined (PGPARSE_CORPUS_H)
+#define PGPARSE_CORPUS_H
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Scanner.h"
+#include "StatementStream.h"
+
+/**
+ * What the parser and bench programs share for reading a corpus of SQL
+ * scripts and splitting it into statements before timing anything, so
+ * that both split it the same way.
+ */
+namespace corpus {
+
+// One statement's tokens, without its semi-colon.
+//
+struct Statement
+{
+	PGParse::token_iterator begin;
+	PGParse::token_iterator end;
+	std::size_t tokens;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+inline double
+seconds(Clock::time_point since)
+{
+	return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+inline bool
+readFile(const char *path, std::string& contents)
+{
+	std::ifstream in(path, std::ios::in | std::ios::binary);
+	if (!in) {
+		return false;
+	}
+	std::ostringstream out;
+	out << in.rdbuf();
+	contents = out.str();
+	return true;
+}
+
+// Add the statements in 'scanner's tokens to 'statements'.  They end
+// at semi-colons outside parentheses, where StatementStream would
+// resynchronize, and empty ones are left out.
+//
+inline void
+split(const PGParse::Scanner& scanner, std::vector<Statement>& statements)
+{
+	PGParse::token_iterator begin = scanner.tokensBegin(PGParse::TOKEN_IS_IGNORED);
+	PGParse::token_iterator end = scanner.tokensEnd();
+	while (begin != end) {
+		PGParse::token_iterator next = PGParse::resynchronize(begin, end);
+		Statement statement = { begin, begin, 0 };
+		while (statement.end != next && statement.end->id() != PGParse::SEMI_COLON_T) {
+			statement.end ++;
+			statement.tokens ++;
+		}
+		if (statement.tokens) {
+			statements.push_back(statement);
+		}
+		begin = next;
+	}
+}
+
+} // corpus
+
+#endif // PGPARSE_CORPUS_H
@@ -0,0 +1,375 @@
+#if !defined (PGPARSE_SPIRIT_GRAMMAR_H)
+#define PGPARSE_SPIRIT_GRAMMAR_H
+
+#include <boost/spirit/include/qi.hpp>
+
+#include "Token.h"
+
+/**
+ * The statements of Grammar.h as a Boost Spirit (Qi) grammar, parsing
+ * the scanner's tokens rather than characters.
+ *
+ * The grammar runs straight over TokenList iterators that skip ignored
+ * tokens, so there's no skipper.  Tokens are matched by two terminals
+ * of our own: tok(id) for one kind of token, and tok_is(flags) for any
+ * in the given categories, like Node.h's T and C.  The rules mirror
+ * Grammar.h one for one, both being ordered choice with backtracking,
+ * so the two accept the same statements.  Expressions are a rule per
+ * precedence level, all grouping to the left as Expr's do, with prefix
+ * operators allowed wherever an operand is.
+ *
+ * The grammar only recognizes statements; building a tree as well
+ * would mean giving every rule an attribute.
+ */
+
+namespace sql {
+
+BOOST_SPIRIT_TERMINAL_EX(tok)
+BOOST_SPIRIT_TERMINAL_EX(tok_is)
+
+/**
+ * The parser behind both terminals: a token with the given id, or if
+ * 'flags' isn't zero, one with any of those category flags.
+ */
+struct TokenParser : boost::spirit::qi::primitive_parser<TokenParser>
+{
+	template <class Context, class Iterator>
+	struct attribute
+	{
+		typedef boost::spirit::unused_type type;
+	};
+
+	PGParse::TokenId id;
+	int flags;
+
+	TokenParser(PGParse::TokenId id, int flags) : id(id), flags(flags)
+	{}
+
+	template <class Iterator, class Context, class Skipper, class Attribute>
+	bool
+	parse(Iterator& first, const Iterator& last, Context&, const Skipper& skipper, Attribute&) const
+	{
+		boost::spirit::qi::skip_over(first, last, skipper);
+		if (first != last && (flags ? first->is(flags) : first->id() == id)) {
+			++ first;
+			return true;
+		}
+		return false;
+	}
+
+	template <class Context>
+	boost::spirit::info
+	what(Context&) const
+	{
+		return boost::spirit::info("token", flags ? PGParse::categoryString(flags) : PGParse::idString(id));
+	}
+};
+
+} // sql
+
+namespace boost { namespace spirit {
+
+template <class A0>
+struct use_terminal< qi::domain, terminal_ex< sql::tag::tok, fusion::vector1<A0> > > : mpl::true_
+{};
+
+template <class A0>
+struct use_terminal< qi::domain, terminal_ex< sql::tag::tok_is, fusion::vector1<A0> > > : mpl::true_
+{};
+
+namespace qi {
+
+template <class Modifiers, class A0>
+struct make_primitive< terminal_ex< sql::tag::tok, fusion::vector1<A0> >, Modifiers >
+{
+	typedef sql::TokenParser result_type;
+
+	template <class Terminal>
+	result_type
+	operator () (const Terminal& term, unused_type) const
+	{
+		return result_type(fusion::at_c<0>(term.args), 0);
+	}
+};
+
+template <class Modifiers, class A0>
+struct make_primitive< terminal_ex< sql::tag::tok_is, fusion::vector1<A0> >, Modifiers >
+{
+	typedef sql::TokenParser result_type;
+
+	template <class Terminal>
+	result_type
+	operator () (const Terminal& term, unused_type) const
+	{
+		return result_type(PGParse::INVALID, fusion::at_c<0>(term.args));
+	}
+};
+
+} } } // boost::spirit::qi
+
+namespace sql {
+
+namespace qi = boost::spirit::qi;
+
+typedef PGParse::TokenList::const_iterator Iterator;
+
+struct SqlGrammar : qi::grammar<Iterator>
+{
+	typedef qi::rule<Iterator> Rule;
+
+	Rule col_id, qualified_name, name_list, column_list, qualified_name_list;
+	Rule type_modifiers, time_zone, simple_type_name, type_name;
+	Rule sconst, constant, expr_list, subquery, func_call, when, case_expr;
+	Rule primary, predicate, operand, atom, cast_level, unary;
+	Rule exp_level, mul_level, add_level, op_level, cmp_level, and_level, a_expr;
+	Rule target, target_list, alias, table_primary, join_type, join_qual, join;
+	Rule table_ref, from_list, from_clause, where_clause, distinct, row;
+	Rule simple_select, set_operation, sort_by, sort_clause, limit_clause, offset_clause;
+	Rule select_stmt, returning, insert_stmt, set_clause, update_stmt, delete_stmt;
+	Rule key_action, references, check, constraint_name, column_constraint;
+	Rule table_constraint, column_def, table_element, temp, create_table;
+	Rule index_element, create_index, create_view, create_stmt;
+	Rule drop_behavior, drop_stmt, alter_table_cmd, alter_table_stmt, stmt;
+
+	SqlGrammar() : SqlGrammar::base_type(stmt)
+	{
+		using namespace PGParse;
+		using sql::tok;
+		using sql::tok_is;
+
+		// Names.
+		//
+		col_id = tok_is(IDENTIFIER_TOKEN | KW_IS_UNRESERVED | KW_IS_COL_NAME);
+		qualified_name = col_id >> -(tok(DOT_T) >> col_id);
+		name_list = col_id % tok(COMMA_T);
+		column_list = tok(OPEN_PAREN_T) >> name_list >> tok(CLOSE_PAREN_T);
+		qualified_name_list = qualified_name % tok(COMMA_T);
+
+		// Types.
+		//
+		type_modifiers = tok(OPEN_PAREN_T) >> (a_expr % tok(COMMA_T)) >> tok(CLOSE_PAREN_T);
+		time_zone = (tok(WITH_KW) | tok(WITHOUT_KW)) >> tok(TIME_KW) >> tok(ZONE_KW);
+		simple_type_name =
+			  tok(DOUBLE_P_KW) >> tok(PRECISION_KW)
+			| (tok(CHARACTER_KW) | tok(CHAR_P_KW) | tok(BIT_KW)) >> -tok(VARYING_KW) >> -type_modifiers
+			| (tok(TIMESTAMP_KW) | tok(TIME_KW)) >> -type_modifiers >> -time_zone
+			| tok(INTERVAL_KW)
+			| qualified_name >> -type_modifiers;
+		type_name = simple_type_name
+			>> *(tok(OPEN_BRACKET_T) >> -tok(INTEGER_T) >> tok(CLOSE_BRACKET_T));
+
+		// Operands.
+		//
+		sconst = tok(STRING_T) | tok(UNI_STRING_T) | tok(DOLQ_STRING_T);
+		constant = tok_is(LITERAL_TOKEN)
+			| tok(TRUE_P_KW) | tok(FALSE_P_KW) | tok(NULL_P_KW);
+		expr_list = a_expr % tok(COMMA_T);
+		subquery = tok(OPEN_PAREN_T) >> select_stmt >> tok(CLOSE_PAREN_T);
+		func_call = qualified_name
+			>> tok(OPEN_PAREN_T)
+			>> -(tok(STAR_T) | -tok(DISTINCT_KW) >> expr_list)
+			>> tok(CLOSE_PAREN_T);
+		when = tok(WHEN_KW) >> a_expr >> tok(THEN_KW) >> a_expr;
+		case_expr = tok(CASE_KW)
+			>> -a_expr
+			>> +when
+			>> -(tok(ELSE_KW) >> a_expr)
+			>> tok(END_P_KW);
+		primary =
+			  constant
+			| tok(PARAM_T)
+			| tok(EXISTS_KW) >> subquery
+			| tok(CAST_KW) >> tok(OPEN_PAREN_T) >> a_expr >> tok(AS_KW) >> type_name >> tok(CLOSE_PAREN_T)
+			| case_expr
+			| subquery
+			| func_call
+			| qualified_name >> sconst
+			| col_id >> *(tok(DOT_T) >> (col_id | tok(STAR_T)));
+		predicate =
+			  tok(IS_KW) >> -tok(NOT_KW) >> (tok(NULL_P_KW) | tok(TRUE_P_KW) | tok(FALSE_P_KW))
+			| tok(ISNULL_KW)
+			| tok(NOTNULL_KW)
+			| -tok(NOT_KW) >> (
+				  tok(IN_P_KW) >> tok(OPEN_PAREN_T) >> (select_stmt | expr_list) >> tok(CLOSE_PAREN_T)
+				| (tok(LIKE_KW) | tok(ILIKE_KW)) >> primary
+				| tok(BETWEEN_KW) >> primary >> tok(AND_KW) >> primary
+			);
+		operand = primary >> -predicate;
+
+		// Expressions, tightest binding first.  A prefix operator's
+		// operand takes in everything that binds tighter than it does.
+		//
+		atom = tok(OPEN_PAREN_T) >> a_expr >> tok(CLOSE_PAREN_T) | operand;
+		cast_level = atom >> *(tok(TYPECAST_T) >> type_name);
+		unary =
+			  tok(NOT_KW) >> cmp_level
+			| (tok(PLUS_T) | tok(MINUS_T)) >> unary
+			| cast_level;
+		exp_level = unary >> *(tok(CARET_T) >> unary);
+		mul_level = exp_level >> *((tok(STAR_T) | tok(SLASH_T) | tok(PERCENT_T)) >> exp_level);
+		add_level = mul_level >> *((tok(PLUS_T) | tok(MINUS_T)) >> mul_level);
+		op_level = add_level >> *(tok(OPERATOR_T) >> add_level);
+		cmp_level = op_level >> *((tok(LESS_THAN_T) | tok(GREATER_THAN_T) | tok(EQUAL_T)) >> op_level);
+		and_level = cmp_level >> *(tok(AND_KW) >> cmp_level);
+		a_expr = and_level >> *(tok(OR_KW) >> and_level);
+
+		// SELECT.
+		//
+		target = tok(STAR_T) | a_expr >> -(tok(AS_KW) >> col_id | tok(IDENTIFIER_T));
+		target_list = target % tok(COMMA_T);
+		alias = tok(AS_KW) >> col_id | tok(IDENTIFIER_T);
+		table_primary = subquery >> -alias | qualified_name >> -alias;
+		join_type =
+			  (tok(FULL_KW) | tok(LEFT_KW) | tok(RIGHT_KW)) >> -tok(OUTER_P_KW)
+			| tok(INNER_P_KW);
+		join_qual = tok(ON_KW) >> a_expr | tok(USING_KW) >> column_list;
+		join =
+			  tok(CROSS_KW) >> tok(JOIN_KW) >> table_primary
+			| tok(NATURAL_KW) >> -join_type >> tok(JOIN_KW) >> table_primary
+			| -join_type >> tok(JOIN_KW) >> table_primary >> join_qual;
+		table_ref = table_primary >> *join;
+		from_list = table_ref % tok(COMMA_T);
+		from_clause = tok(FROM_KW) >> from_list;
+		where_clause = tok(WHERE_KW) >> a_expr;
+		distinct =
+			  tok(DISTINCT_KW) >> -(tok(ON_KW) >> tok(OPEN_PAREN_T) >> expr_list >> tok(CLOSE_PAREN_T))
+			| tok(ALL_KW);
+		row = tok(OPEN_PAREN_T) >> expr_list >> tok(CLOSE_PAREN_T);
+		simple_select =
+			  tok(SELECT_KW)
+				>> -distinct
+				>> -target_list
+				>> -from_clause
+				>> -where_clause
+				>> -(tok(GROUP_P_KW) >> tok(BY_KW) >> expr_list)
+				>> -(tok(HAVING_KW) >> a_expr)
+			| tok(VALUES_KW) >> (row % tok(COMMA_T))
+			| subquery;
+		set_operation = (tok(UNION_KW) | tok(INTERSECT_KW) | tok(EXCEPT_KW))
+			>> -(tok(ALL_KW) | tok(DISTINCT_KW))
+			>> simple_select;
+		sort_by = a_expr
+			>> -(tok(ASC_KW) | tok(DESC_KW))
+			>> -(tok(NULLS_P_KW) >> (tok(FIRST_P_KW) | tok(LAST_P_KW)));
+		sort_clause = tok(ORDER_KW) >> tok(BY_KW) >> (sort_by % tok(COMMA_T));
+		limit_clause = tok(LIMIT_KW) >> (tok(ALL_KW) | a_expr);
+		offset_clause = tok(OFFSET_KW) >> a_expr;
+		select_stmt = simple_select
+			>> *set_operation
+			>> -sort_clause
+			>> -(limit_clause >> -offset_clause | offset_clause >> -limit_clause);
+
+		// INSERT, UPDATE and DELETE.
+		//
+		returning = tok(RETURNING_KW) >> target_list;
+		insert_stmt = tok(INSERT_KW)
+			>> tok(INTO_KW)
+			>> qualified_name
+			>> (tok(DEFAULT_KW) >> tok(VALUES_KW) | -column_list >> select_stmt)
+			>> -returning;
+		set_clause = col_id >> tok(EQUAL_T) >> (tok(DEFAULT_KW) | a_expr);
+		update_stmt = tok(UPDATE_KW)
+			>> qualified_name
+			>> -(tok(AS_KW) >> col_id)
+			>> tok(SET_KW)
+			>> (set_clause % tok(COMMA_T))
+			>> -from_clause
+			>> -where_clause
+			>> -returning;
+		delete_stmt = tok(DELETE_P_KW)
+			>> tok(FROM_KW)
+			>> qualified_name
+			>> -alias
+			>> -(tok(USING_KW) >> from_list)
+			>> -where_clause
+			>> -returning;
+
+		// CREATE TABLE, CREATE INDEX and CREATE VIEW.
+		//
+		key_action =
+			  tok(CASCADE_KW)
+			| tok(RESTRICT_KW)
+			| tok(NO_KW) >> tok(ACTION_KW)
+			| tok(SET_KW) >> (tok(NULL_P_KW) | tok(DEFAULT_KW));
+		references = tok(REFERENCES_KW)
+			>> qualified_name
+			>> -column_list
+			>> *(tok(ON_KW) >> (tok(DELETE_P_KW) | tok(UPDATE_KW)) >> key_action);
+		check = tok(CHECK_KW) >> tok(OPEN_PAREN_T) >> a_expr >> tok(CLOSE_PAREN_T);
+		constraint_name = tok(CONSTRAINT_KW) >> col_id;
+		column_constraint = -constraint_name >> (
+			  tok(NOT_KW) >> tok(NULL_P_KW)
+			| tok(NULL_P_KW)
+			| tok(UNIQUE_KW)
+			| tok(PRIMARY_KW) >> tok(KEY_KW)
+			| check
+			| tok(DEFAULT_KW) >> a_expr
+			| references
+		);
+		table_constraint = -constraint_name >> (
+			  tok(UNIQUE_KW) >> column_list
+			| tok(PRIMARY_KW) >> tok(KEY_KW) >> column_list
+			| check
+			| tok(FOREIGN_KW) >> tok(KEY_KW) >> column_list >> references
+		);
+		column_def = col_id >> type_name >> *column_constraint;
+		table_element = table_constraint | column_def;
+		temp = tok(TEMPORARY_KW) | tok(TEMP_KW);
+		create_table = -temp
+			>> tok(TABLE_KW)
+			>> -(tok(IF_P_KW) >> tok(NOT_KW) >> tok(EXISTS_KW))
+			>> qualified_name
+			>> tok(OPEN_PAREN_T)
+			>> -(table_element % tok(COMMA_T))
+			>> tok(CLOSE_PAREN_T);
+		index_element = (col_id | tok(OPEN_PAREN_T) >> a_expr >> tok(CLOSE_PAREN_T))
+			>> -(tok(ASC_KW) | tok(DESC_KW));
+		create_index = -tok(UNIQUE_KW)
+			>> tok(INDEX_KW)
+			>> -col_id
+			>> tok(ON_KW)
+			>> qualified_name
+			>> tok(OPEN_PAREN_T)
+			>> (index_element % tok(COMMA_T))
+			>> tok(CLOSE_PAREN_T)
+			>> -where_clause;
+		create_view = -(tok(OR_KW) >> tok(REPLACE_KW))
+			>> -temp
+			>> tok(VIEW_KW)
+			>> qualified_name
+			>> -column_list
+			>> tok(AS_KW)
+			>> select_stmt;
+		create_stmt = tok(CREATE_KW) >> (create_table | create_index | create_view);
+
+		// DROP and ALTER TABLE.
+		//
+		drop_behavior = tok(CASCADE_KW) | tok(RESTRICT_KW);
+		drop_stmt = tok(DROP_KW)
+			>> (tok(TABLE_KW) | tok(VIEW_KW) | tok(INDEX_KW))
+			>> -(tok(IF_P_KW) >> tok(EXISTS_KW))
+			>> qualified_name_list
+			>> -drop_behavior;
+		alter_table_cmd =
+			  tok(ADD_P_KW) >> (table_constraint | -tok(COLUMN_KW) >> column_def)
+			| tok(DROP_KW) >> -tok(COLUMN_KW) >> col_id >> -drop_behavior
+			| tok(RENAME_KW) >> tok(TO_KW) >> col_id
+			| tok(RENAME_KW) >> -tok(COLUMN_KW) >> col_id >> tok(TO_KW) >> col_id;
+		alter_table_stmt = tok(ALTER_KW)
+			>> tok(TABLE_KW)
+			>> qualified_name
+			>> (alter_table_cmd % tok(COMMA_T));
+
+		stmt = select_stmt
+			| insert_stmt
+			| update_stmt
+			| delete_stmt
+			| create_stmt
+			| drop_stmt
+			| alter_table_stmt;
+	}
+};
+
+} // sql
+
+#endif // PGPARSE_SPIRIT_GRAMMAR_H
@@ -0,0 +1,134 @@
+#if !defined (PGPARSE_ARENA_H)
+#define PGPARSE_ARENA_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace PGParse {
+
+/**
+ * A bump allocator for objects that all die together, like the nodes
+ * of a parse tree.
+ *
+ * Memory comes from a list of large blocks.  Allocation just moves a
+ * pointer, and nothing is ever freed individually: rewind() gives back
+ * everything allocated since a mark (for abandoning a failed parse),
+ * clear() gives back everything while keeping the blocks for reuse,
+ * and the destructor releases the blocks.  Objects in the arena never
+ * have their destructors run, so they must not own other resources.
+ */
+class Arena
+{
+public:
+	struct Mark
+	{
+		std::size_t block;
+		std::size_t used;
+
+		// Whether this mark is further on in the arena than 'other'.
+		//
+		bool
+		after(const Mark& other) const
+		{
+			return block > other.block || (block == other.block && used > other.used);
+		}
+	};
+
+private:
+	struct Block
+	{
+		char *bytes;
+		std::size_t size;
+	};
+
+	std::vector<Block> blocks_;
+	std::size_t current_;
+	std::size_t used_;
+	std::size_t block_size_;
+
+	// Allocations are rounded up so that anything can be stored
+	// at the returned address.
+	//
+	static std::size_t
+	align(std::size_t size)
+	{
+		const std::size_t a = sizeof(void *) * 2;
+		return (size + a - 1) & ~(a - 1);
+	}
+
+	void *
+	allocateSlow(std::size_t size)
+	{
+		// Move on to the next block, reusing blocks left over from
+		// a rewind or clear when they are big enough.
+		//
+		std::size_t next = blocks_.empty() ? 0 : current_ + 1;
+		if (next >= blocks_.size() || blocks_[next].size < size) {
+			Block block;
+			block.size = size > block_size_ ? size : block_size_;
+			block.bytes = static_cast<char *>(std::malloc(block.size));
+			if (!block.bytes) {
+				throw std::bad_alloc();
+			}
+			blocks_.insert(blocks_.begin() + next, block);
+		}
+		current_ = next;
+		used_ = size;
+		return blocks_[current_].bytes;
+	}
+
+	Arena(const Arena&);
+	Arena& operator=(const Arena&);
+
+public:
+	explicit
+	Arena(std::size_t block_size = 64 * 1024)
+		: blocks_(), current_(0), used_(0), block_size_(block_size)
+	{}
+
+	~Arena()
+	{
+		for (std::size_t i = 0; i < blocks_.size(); i ++) {
+			std::free(blocks_[i].bytes);
+		}
+	}
+
+	void *
+	allocate(std::size_t size)
+	{
+		size = align(size);
+		if (!blocks_.empty() && blocks_[current_].size - used_ >= size) {
+			void *ret = blocks_[current_].bytes + used_;
+			used_ += size;
+			return ret;
+		}
+		return allocateSlow(size);
+	}
+
+	Mark
+	mark() const
+	{
+		Mark ret = { current_, used_ };
+		return ret;
+	}
+
+	void
+	rewind(const Mark& mark)
+	{
+		current_ = mark.block;
+		used_ = mark.used;
+	}
+
+	void
+	clear()
+	{
+		current_ = 0;
+		used_ = 0;
+	}
+};
+
+} // PGParse
+
+#endif // PGPARSE_ARENA_H
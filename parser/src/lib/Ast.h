@@ -0,0 +1,255 @@
+#if !defined (PGPARSE_AST_H)
+#define PGPARSE_AST_H
+
+#include "FlatTree.h"
+#include <cstdint>
+#include <string>
+
+namespace PGParse {
+
+/**
+ * The kinds of node in the trees the Lemon grammar builds.  Each is a
+ * type with a ruleString(), like a Node.h rule, so FlatTree gives it a
+ * kind number and kindString() works the same for both engines.
+ */
+namespace Ast {
+
+#define PGPARSE_AST_KIND(name, text) \
+	struct name \
+	{ \
+		static std::string \
+		ruleString(int indent = 0) \
+		{ \
+			return text; \
+		} \
+	};
+
+// Statements and their clauses.
+//
+PGPARSE_AST_KIND(Statements,	"statements")
+PGPARSE_AST_KIND(Select,	"select")
+PGPARSE_AST_KIND(Query,		"query")
+PGPARSE_AST_KIND(SetOperation,	"set operation")
+PGPARSE_AST_KIND(Distinct,	"distinct")
+PGPARSE_AST_KIND(Targets,	"targets")
+PGPARSE_AST_KIND(Target,	"target")
+PGPARSE_AST_KIND(Star,		"star")
+PGPARSE_AST_KIND(From,		"from")
+PGPARSE_AST_KIND(TableRef,	"table ref")
+PGPARSE_AST_KIND(Join,		"join")
+PGPARSE_AST_KIND(JoinType,	"join type")
+PGPARSE_AST_KIND(Where,		"where")
+PGPARSE_AST_KIND(GroupBy,	"group by")
+PGPARSE_AST_KIND(Having,	"having")
+PGPARSE_AST_KIND(OrderBy,	"order by")
+PGPARSE_AST_KIND(SortBy,	"sort by")
+PGPARSE_AST_KIND(Direction,	"direction")
+PGPARSE_AST_KIND(Limit,		"limit")
+PGPARSE_AST_KIND(Offset,	"offset")
+PGPARSE_AST_KIND(Values,	"values")
+PGPARSE_AST_KIND(Row,		"row")
+PGPARSE_AST_KIND(Insert,	"insert")
+PGPARSE_AST_KIND(Columns,	"columns")
+PGPARSE_AST_KIND(DefaultValues,	"default values")
+PGPARSE_AST_KIND(Returning,	"returning")
+PGPARSE_AST_KIND(Update,	"update")
+PGPARSE_AST_KIND(SetClauses,	"set clauses")
+PGPARSE_AST_KIND(SetClause,	"set clause")
+PGPARSE_AST_KIND(Delete,	"delete")
+PGPARSE_AST_KIND(CreateTable,	"create table")
+PGPARSE_AST_KIND(CreateIndex,	"create index")
+PGPARSE_AST_KIND(CreateView,	"create view")
+PGPARSE_AST_KIND(Option,	"option")
+PGPARSE_AST_KIND(TableElements,	"table elements")
+PGPARSE_AST_KIND(ColumnDef,	"column definition")
+PGPARSE_AST_KIND(Constraints,	"constraints")
+PGPARSE_AST_KIND(Constraint,	"constraint")
+PGPARSE_AST_KIND(References,	"references")
+PGPARSE_AST_KIND(IndexElements,	"index elements")
+PGPARSE_AST_KIND(Drop,		"drop")
+PGPARSE_AST_KIND(Names,		"names")
+PGPARSE_AST_KIND(AlterTable,	"alter table")
+PGPARSE_AST_KIND(AlterCommands,	"alter commands")
+PGPARSE_AST_KIND(AlterCommand,	"alter command")
+
+// Expressions and names.
+//
+PGPARSE_AST_KIND(Name,		"name")
+PGPARSE_AST_KIND(Identifier,	"identifier")
+PGPARSE_AST_KIND(Constant,	"constant")
+PGPARSE_AST_KIND(Param,		"param")
+PGPARSE_AST_KIND(Operator,	"operator")
+PGPARSE_AST_KIND(Operation,	"operation")
+PGPARSE_AST_KIND(Cast,		"cast")
+PGPARSE_AST_KIND(TypeName,	"type name")
+PGPARSE_AST_KIND(FuncCall,	"function call")
+PGPARSE_AST_KIND(Arguments,	"arguments")
+PGPARSE_AST_KIND(ExprList,	"expression list")
+PGPARSE_AST_KIND(Subquery,	"subquery")
+PGPARSE_AST_KIND(Case,		"case")
+PGPARSE_AST_KIND(When,		"when")
+PGPARSE_AST_KIND(Else,		"else")
+
+#undef PGPARSE_AST_KIND
+
+} // Ast
+
+/**
+ * A list node under construction: the node, and its last child so far,
+ * so that appending doesn't have to walk the list.
+ */
+struct AstList
+{
+	uint32_t node;
+	uint32_t last;
+};
+
+/**
+ * What the Lemon grammar's actions build the tree with, and the rest
+ * of the state of one parse.  Passed to Parse() as its extra argument.
+ *
+ * Terminals' values are their indexes in the token list, and
+ * non-terminals' values are node indexes in 'tree', or FlatTree::NONE
+ * for optional parts that weren't there.  Nodes are made once their
+ * children are, so each covers the tokens of its children plus any
+ * tokens of its own that the action passes in.
+ */
+class AstBuilder
+{
+public:
+	static const uint32_t NONE = FlatTree::NONE;
+
+	FlatTree& tree;
+	uint32_t root;
+	bool failed;
+	uint32_t error_token;
+
+	explicit
+	AstBuilder(FlatTree& tree) : tree(tree), root(NONE), failed(false), error_token(NONE)
+	{}
+
+	// Forget the last parse's result, but not its tree.
+	//
+	void
+	reset()
+	{
+		root = NONE;
+		failed = false;
+		error_token = NONE;
+	}
+
+	void
+	syntaxError(uint32_t token)
+	{
+		if (!failed) {
+			failed = true;
+			error_token = token;
+		}
+	}
+
+	// A node for the single token at 'token'.
+	//
+	template <class KIND>
+	uint32_t
+	leaf(uint32_t token)
+	{
+		return tree.leaf(FlatTree::kind<KIND>(), token);
+	}
+
+	/**
+	 * A node covering the tokens 'first' to 'last' of its own (either
+	 * can be NONE) and the children given, in order.  Children that
+	 * are NONE are left out.  A node with no tokens at all, like an
+	 * empty list, has an empty range at token 0.
+	 */
+	template <class KIND>
+	uint32_t
+	make(
+		uint32_t first,
+		uint32_t last,
+		uint32_t a = NONE,
+		uint32_t b = NONE,
+		uint32_t c = NONE,
+		uint32_t d = NONE,
+		uint32_t e = NONE,
+		uint32_t f = NONE
+	)
+	{
+		uint32_t ret = extend(tree.open(FlatTree::kind<KIND>(), 0), first, last);
+		const uint32_t children[] = { a, b, c, d, e, f };
+		uint32_t previous = NONE;
+		for (std::size_t i = 0; i < sizeof(children) / sizeof(children[0]); i ++) {
+			if (children[i] != NONE) {
+				add(ret, previous, children[i]);
+				previous = children[i];
+			}
+		}
+		return ret;
+	}
+
+	/**
+	 * Widen the node at 'index' to take in the tokens 'first' to 'last'
+	 * as well, for a clause that is only its keywords and a list.
+	 */
+	uint32_t
+	extend(uint32_t index, uint32_t first, uint32_t last)
+	{
+		if (first != NONE || last != NONE) {
+			cover(index, first == NONE ? last : first, (last == NONE ? first : last) + 1);
+		}
+		return index;
+	}
+
+	// A list node holding 'item', if there is one.
+	//
+	template <class KIND>
+	AstList
+	list(uint32_t item)
+	{
+		AstList ret = { make<KIND>(NONE, NONE), NONE };
+		return append(ret, item);
+	}
+
+	AstList
+	append(AstList list, uint32_t item)
+	{
+		if (item != NONE) {
+			add(list.node, list.last, item);
+			list.last = item;
+		}
+		return list;
+	}
+
+private:
+	// Widen the node at 'index' to take in the tokens from 'first' up
+	// to 'end'.  Nodes without tokens yet (empty lists) cover nothing.
+	//
+	void
+	cover(uint32_t index, uint32_t first, uint32_t end)
+	{
+		const FlatNode& node = tree[index];
+		if (first >= end) {
+			return;
+		}
+		if (node.first_token >= node.end_token) {
+			tree.span(index, first, end);
+		} else {
+			tree.span(
+				index,
+				first < node.first_token ? first : node.first_token,
+				end > node.end_token ? end : node.end_token
+			);
+		}
+	}
+
+	void
+	add(uint32_t parent, uint32_t previous, uint32_t child)
+	{
+		tree.link(parent, previous, child);
+		cover(parent, tree[child].first_token, tree[child].end_token);
+	}
+};
+
+} // PGParse
+
+#endif // PGPARSE_AST_H
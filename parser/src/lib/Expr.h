@@ -0,0 +1,723 @@
+#if !defined (PGPARSE_EXPR_H)
+#define PGPARSE_EXPR_H
+
+#include "Node.h"
+#include <vector>
+
+namespace PGParse {
+
+/**
+ * Binding strengths of the operators Expr knows about, following the
+ * precedence declarations in PostgreSQL's gram.y.  Higher binds
+ * tighter; NONE means the token isn't an operator in that position.
+ *
+ * The scanner returns multi-character operators such as <= and <> as
+ * OPERATOR_T without their text, so those get the precedence of
+ * PostgreSQL's generic Op rather than that of the comparisons.
+ */
+struct ExprPrecedence
+{
+	enum {
+		NONE = 0,
+		OR,
+		AND,
+		NOT,
+		COMPARISON,
+		OTHER,		// Any other operator (Op)
+		ADD,
+		MULTIPLY,
+		EXPONENT,
+		UNARY,
+		TYPECAST
+	};
+
+	static int
+	infix(TokenId id)
+	{
+		switch (id) {
+		case OR_KW:
+			return OR;
+		case AND_KW:
+			return AND;
+		case LESS_THAN_T:
+		case GREATER_THAN_T:
+		case EQUAL_T:
+			return COMPARISON;
+		case OPERATOR_T:
+			return OTHER;
+		case PLUS_T:
+		case MINUS_T:
+			return ADD;
+		case STAR_T:
+		case SLASH_T:
+		case PERCENT_T:
+			return MULTIPLY;
+		case CARET_T:
+			return EXPONENT;
+		case TYPECAST_T:
+			return TYPECAST;
+		default:
+			return NONE;
+		}
+	}
+
+	static int
+	prefix(TokenId id)
+	{
+		switch (id) {
+		case NOT_KW:
+			return NOT;
+		case PLUS_T:
+		case MINUS_T:
+			return UNARY;
+		default:
+			return NONE;
+		}
+	}
+};
+
+/**
+ * The value Expr::parseValue() fills in: the expression in postfix
+ * order.  Each OPERAND step takes the next of 'operands', each CAST
+ * step the next of 'types', and operators apply to the results of the
+ * steps before them.  Parentheses leave no trace beyond the order.
+ */
+template <class PRIMARY, class TYPENAME>
+struct ExprValue
+{
+	struct Step
+	{
+		enum Form { OPERAND, PREFIX, INFIX, CAST } form;
+		token_iterator op;
+	};
+
+	std::vector<Step> steps;
+	std::vector<typename PRIMARY::Value> operands;
+	std::vector<typename TYPENAME::Value> types;
+};
+
+/**
+ * An expression over operands matched by PRIMARY, parsed by
+ * precedence climbing rather than by a rule per precedence level.
+ *
+ * Prefix NOT, + and -, the binary operators ExprPrecedence lists,
+ * parenthesized subexpressions, and postfix ::TYPENAME casts are all
+ * handled here, in a single pass that never backtracks more than one
+ * operator: if an operator isn't followed by an operand, the
+ * expression ends before it.  All binary operators group to the left.
+ *
+ * Operands that are just a PRIMARY aren't wrapped in anything, so the
+ * operands of an Expr node are either PRIMARY nodes or more Expr
+ * nodes.  The same goes for FlatTree output, where an operator's node
+ * comes after its left operand, since that's parsed first.
+ */
+template <class PRIMARY, class TYPENAME = PRIMARY>
+class Expr : public Node
+{
+public:
+	enum Form {
+		OPERAND,	// Just left()
+		PREFIX,		// op() right()
+		INFIX,		// left() op() right()
+		CAST		// left() op() right(), with right() a TYPENAME
+	};
+
+	typedef ExprValue<PRIMARY, TYPENAME> Value;
+
+private:
+	Form form_;
+	token_iterator op_;
+	Node *left_;
+	Node *right_;
+
+	Expr(Form form, token_iterator op, Node *left, Node *right)
+		: form_(form), op_(op), left_(left), right_(right)
+	{}
+
+	// The things climb() can build as it goes.  Each says what a
+	// result is, how to make one from its parts, and how to undo
+	// everything built since a mark.
+	//
+
+	struct Nodes
+	{
+		typedef Node *Result;
+		typedef Arena::Mark Mark;
+
+		ParseContext& context;
+		Node *last;	// The most recent Expr built, if it's still there
+		Mark before_last;	// Where it was allocated
+
+		static bool ok(Result r) { return r != 0; }
+		static Result failed() { return 0; }
+		Mark mark() { return context.arena.mark(); }
+
+		// Once 'last' is given back its memory can go to another
+		// node, so it mustn't be mistaken for that one.
+		//
+		void
+		rewind(const Mark& mark)
+		{
+			if (!mark.after(before_last)) {
+				last = 0;
+			}
+			context.rewind(mark);
+		}
+
+		Result
+		operand(token_iterator &begin, const token_iterator &end)
+		{
+			return PRIMARY::parse(begin, end, context);
+		}
+
+		Result
+		type(token_iterator &begin, const token_iterator &end)
+		{
+			return TYPENAME::parse(begin, end, context);
+		}
+
+		Result
+		combine(Form form, Result left, token_iterator op, Result right)
+		{
+			before_last = context.arena.mark();
+			last = new (context) Expr(form, op, left, right);
+			return last;
+		}
+	};
+
+	struct Matches
+	{
+		typedef bool Result;
+		typedef int Mark;
+
+		MatchState& state;
+
+		static bool ok(Result r) { return r; }
+		static Result failed() { return false; }
+		Mark mark() { return 0; }
+		void rewind(const Mark& mark) {}
+
+		Result
+		operand(token_iterator &begin, const token_iterator &end)
+		{
+			return PRIMARY::match(begin, end, state);
+		}
+
+		Result
+		type(token_iterator &begin, const token_iterator &end)
+		{
+			return TYPENAME::match(begin, end, state);
+		}
+
+		Result
+		combine(Form form, Result left, token_iterator op, Result right)
+		{
+			return true;
+		}
+	};
+
+	struct Flat
+	{
+		typedef uint32_t Result;
+		typedef uint32_t Mark;
+
+		FlatTree& tree;
+
+		// An operand that matched nothing has no node to link, and
+		// isn't much of an operand anyway.
+		//
+		static bool ok(Result r) { return r != FlatTree::NONE && r != FlatTree::EMPTY; }
+		static Result failed() { return FlatTree::NONE; }
+		Mark mark() { return tree.size(); }
+		void rewind(const Mark& mark) { tree.truncate(mark); }
+
+		Result
+		operand(token_iterator &begin, const token_iterator &end)
+		{
+			return PRIMARY::build(begin, end, tree);
+		}
+
+		Result
+		type(token_iterator &begin, const token_iterator &end)
+		{
+			return TYPENAME::build(begin, end, tree);
+		}
+
+		// Prefix operators are opened before their operand is
+		// parsed, so 'left' is the already open node.
+		//
+		Result
+		combine(Form form, Result left, token_iterator op, Result right)
+		{
+			if (form == PREFIX) {
+				tree.link(left, FlatTree::NONE, right);
+				tree.close(left, right);
+				return left;
+			}
+			uint32_t ret = tree.open(FlatTree::kind<Expr>(), tree[left].first_token);
+			tree.link(ret, FlatTree::NONE, left);
+			tree.link(ret, left, right);
+			tree.close(ret, right);
+			return ret;
+		}
+	};
+
+	struct Values
+	{
+		typedef bool Result;
+
+		struct Mark
+		{
+			std::size_t steps;
+			std::size_t operands;
+			std::size_t types;
+		};
+
+		Value& value;
+
+		static bool ok(Result r) { return r; }
+		static Result failed() { return false; }
+
+		Mark
+		mark()
+		{
+			Mark ret = { value.steps.size(), value.operands.size(), value.types.size() };
+			return ret;
+		}
+
+		void
+		rewind(const Mark& mark)
+		{
+			value.steps.resize(mark.steps);
+			value.operands.resize(mark.operands);
+			value.types.resize(mark.types);
+		}
+
+		Result
+		operand(token_iterator &begin, const token_iterator &end)
+		{
+			typename PRIMARY::Value operand;
+			if (!PRIMARY::parseValue(begin, end, operand)) {
+				return false;
+			}
+			value.operands.push_back(std::move(operand));
+			addStep(Value::Step::OPERAND, token_iterator());
+			return true;
+		}
+
+		Result
+		type(token_iterator &begin, const token_iterator &end)
+		{
+			typename TYPENAME::Value type;
+			if (!TYPENAME::parseValue(begin, end, type)) {
+				return false;
+			}
+			value.types.push_back(std::move(type));
+			return true;
+		}
+
+		Result
+		combine(Form form, Result left, token_iterator op, Result right)
+		{
+			static const typename Value::Step::Form forms[] = {
+				Value::Step::OPERAND,
+				Value::Step::PREFIX,
+				Value::Step::INFIX,
+				Value::Step::CAST
+			};
+			addStep(forms[form], op);
+			return true;
+		}
+
+		void
+		addStep(typename Value::Step::Form form, token_iterator op)
+		{
+			typename Value::Step step = { form, op };
+			value.steps.push_back(step);
+		}
+	};
+
+	// For the prefix case FlatTree needs its node opened first; the
+	// other builders don't have anything to do until the end.
+	//
+	static Node *
+	startPrefix(Nodes& builder, token_iterator op) { return 0; }
+
+	static bool
+	startPrefix(Matches& builder, token_iterator op) { return true; }
+
+	static bool
+	startPrefix(Values& builder, token_iterator op) { return true; }
+
+	static uint32_t
+	startPrefix(Flat& builder, token_iterator op)
+	{
+		return builder.tree.open(FlatTree::kind<Expr>(), op.index());
+	}
+
+	// match() records where an operator or a closing parenthesis
+	// could have come next, as ZeroOrMore does for its next item, so
+	// the furthest failure shows whether the expression could have
+	// gone on past the end of the input.
+	//
+	template <class BUILDER>
+	static void
+	expected(BUILDER& builder, const token_iterator& at) {}
+
+	static void
+	expected(Matches& builder, const token_iterator& at)
+	{
+		builder.state.fail(at);
+	}
+
+	/**
+	 * Parse an expression whose operators all bind at least as
+	 * tightly as 'min_precedence'.
+	 */
+	template <class BUILDER>
+	static typename BUILDER::Result
+	climb (
+		token_iterator &begin,
+		const token_iterator &end,
+		BUILDER& builder,
+		int min_precedence
+	)
+	{
+		typedef typename BUILDER::Result Result;
+
+		token_iterator start = begin;
+		typename BUILDER::Mark mark = builder.mark();
+		Result left = BUILDER::failed();
+
+		int precedence = begin == end ? ExprPrecedence::NONE : ExprPrecedence::prefix(begin->id());
+		if (precedence != ExprPrecedence::NONE) {
+			token_iterator op = begin;
+			Result prefix = startPrefix(builder, op);
+			begin ++;
+			Result operand = climb(begin, end, builder, precedence);
+			if (!BUILDER::ok(operand)) {
+				builder.rewind(mark);
+				begin = start;
+				return BUILDER::failed();
+			}
+			left = builder.combine(PREFIX, prefix, op, operand);
+		} else if (begin != end && begin->id() == OPEN_PAREN_T) {
+			begin ++;
+			left = climb(begin, end, builder, ExprPrecedence::NONE + 1);
+			if (BUILDER::ok(left) && begin != end && begin->id() == CLOSE_PAREN_T) {
+				begin ++;
+			} else {
+				// Maybe PRIMARY knows what to do with it.
+				expected(builder, begin);
+				builder.rewind(mark);
+				begin = start;
+				left = BUILDER::failed();
+			}
+		}
+		if (!BUILDER::ok(left)) {
+			left = builder.operand(begin, end);
+			if (!BUILDER::ok(left)) {
+				builder.rewind(mark);
+				begin = start;
+				return BUILDER::failed();
+			}
+		}
+
+		while (begin != end) {
+			precedence = ExprPrecedence::infix(begin->id());
+			if (precedence == ExprPrecedence::NONE || precedence < min_precedence) {
+				break;
+			}
+			token_iterator op = begin;
+			typename BUILDER::Mark before = builder.mark();
+			begin ++;
+			Form form = precedence == ExprPrecedence::TYPECAST ? CAST : INFIX;
+			Result right = form == CAST
+				? builder.type(begin, end)
+				: climb(begin, end, builder, precedence + 1);
+			if (!BUILDER::ok(right)) {
+				builder.rewind(before);
+				begin = op;
+				break;
+			}
+			left = builder.combine(form, left, op, right);
+		}
+		expected(builder, begin);
+		return left;
+	}
+
+	// climb() as a frame of a ResumableParse, with the minimum
+	// precedence in frame.level, the left operand so far in
+	// frame.node, and an operator's index in frame.token.  It ends
+	// with flags of 1 if its node is an Expr, as resume() needs to
+	// know; frame.index keeps track of that.
+	//
+	enum ClimbState {
+		CLIMB_START,
+		CLIMB_PREFIX,	// Waiting for a prefix operator's operand
+		CLIMB_PAREN,	// Waiting for what's in parentheses
+		CLIMB_CLOSE,	// Looking for the closing parenthesis
+		CLIMB_OPERAND,	// Waiting for PRIMARY
+		CLIMB_LOOP,	// Looking for an operator
+		CLIMB_RIGHT	// Waiting for an operator's right operand
+	};
+
+	static void
+	resumeClimb(ResumableParse& parse, ResumableParse::Frame& frame)
+	{
+		const Token *token;
+		int precedence;
+
+		switch (frame.state) {
+		case CLIMB_START:
+			if (!parse.ready()) {
+				return;
+			}
+			token = parse.token();
+			precedence = token ? ExprPrecedence::prefix(token->id()) : ExprPrecedence::NONE;
+			if (precedence != ExprPrecedence::NONE) {
+				frame.token = parse.position();
+				frame.state = CLIMB_PREFIX;
+				parse.advance();
+				parse.call(&resumeClimb).level = precedence;
+			} else if (token && token->id() == OPEN_PAREN_T) {
+				frame.state = CLIMB_PAREN;
+				parse.advance();
+				parse.call(&resumeClimb).level = ExprPrecedence::NONE + 1;
+			} else {
+				frame.state = CLIMB_OPERAND;
+				parse.call(&PRIMARY::resume);
+			}
+			return;
+		case CLIMB_PREFIX:
+			if (!parse.result()) {
+				parse.fail();
+				return;
+			}
+			frame.node = new (parse.context()) Expr(PREFIX, parse.iterator(frame.token), 0, parse.result());
+			frame.index = 1;
+			frame.state = CLIMB_LOOP;
+			break;
+		case CLIMB_PAREN:
+			frame.node = parse.result();
+			frame.index = parse.flags();
+			frame.state = CLIMB_CLOSE;
+			// Fall through
+		case CLIMB_CLOSE:
+			if (frame.node) {
+				if (!parse.ready()) {
+					return;
+				}
+				token = parse.token();
+				if (token && token->id() == CLOSE_PAREN_T) {
+					parse.advance();
+					frame.state = CLIMB_LOOP;
+					break;
+				}
+			}
+			// Maybe PRIMARY knows what to do with it.
+			parse.expected();
+			parse.backtrack(frame.start);
+			parse.context().rewind(frame.mark);
+			frame.node = 0;
+			frame.index = 0;
+			frame.state = CLIMB_OPERAND;
+			parse.call(&PRIMARY::resume);
+			return;
+		case CLIMB_OPERAND:
+			if (!parse.result()) {
+				parse.fail();
+				return;
+			}
+			frame.node = parse.result();
+			frame.state = CLIMB_LOOP;
+			break;
+		case CLIMB_LOOP:
+			break;
+		case CLIMB_RIGHT:
+			if (!parse.result()) {
+				// The expression ends before the operator.
+				parse.backtrack(frame.token);
+				parse.expected();
+				parse.succeed(frame.node, frame.index);
+				return;
+			}
+			frame.node = new (parse.context()) Expr(
+				parse.iterator(frame.token)->id() == TYPECAST_T ? CAST : INFIX,
+				parse.iterator(frame.token),
+				frame.node,
+				parse.result()
+			);
+			frame.index = 1;
+			frame.state = CLIMB_LOOP;
+			break;
+		}
+
+		if (!parse.ready()) {
+			return;
+		}
+		token = parse.token();
+		precedence = token ? ExprPrecedence::infix(token->id()) : ExprPrecedence::NONE;
+		if (precedence == ExprPrecedence::NONE || precedence < frame.level) {
+			parse.expected();
+			parse.succeed(frame.node, frame.index);
+			return;
+		}
+		frame.token = parse.position();
+		frame.state = CLIMB_RIGHT;
+		parse.advance();
+		if (precedence == ExprPrecedence::TYPECAST) {
+			parse.call(&TYPENAME::resume);
+		} else {
+			parse.call(&resumeClimb).level = precedence + 1;
+		}
+	}
+
+	static Expr *
+	parseExpr (token_iterator &begin, const token_iterator &end, ParseContext& context)
+	{
+		PGPARSE_PROFILE_START(Expr, begin);
+		Nodes builder = { context, 0, context.arena.mark() };
+		Node *node = climb(begin, end, builder, ExprPrecedence::NONE + 1);
+		PGPARSE_PROFILE_FINISH(node != 0, begin);
+		if (!node) {
+			return 0;
+		}
+		// The top of the tree has to be an Expr, even if it's
+		// just an operand.  If it is one already, it was the last
+		// one built.
+		if (node == builder.last) {
+			return static_cast<Expr *>(node);
+		}
+		return new (context) Expr(OPERAND, token_iterator(), node, 0);
+	}
+
+public:
+	Form
+	form() const
+	{
+		return form_;
+	}
+
+	const token_iterator&
+	op() const
+	{
+		return op_;
+	}
+
+	Node *
+	left() const
+	{
+		return left_;
+	}
+
+	Node *
+	right() const
+	{
+		return right_;
+	}
+
+	void
+	accept(NodeVisitor& visitor) const
+	{
+		switch (form_) {
+		case OPERAND:
+			left_->accept(visitor);
+			break;
+		case PREFIX:
+			if (visitor.enter(*this, EXPRESSION, 2)) {
+				visitor.token(*this, *op_);
+				right_->accept(visitor);
+			}
+			visitor.leave(*this, EXPRESSION, 2);
+			break;
+		default:
+			if (visitor.enter(*this, EXPRESSION, 3)) {
+				left_->accept(visitor);
+				visitor.token(*this, *op_);
+				right_->accept(visitor);
+			}
+			visitor.leave(*this, EXPRESSION, 3);
+			break;
+		}
+	}
+
+	static std::string
+	ruleString(int indent = 0)
+	{
+		return std::string(" expr( ") + PRIMARY::ruleString(indent) + " ) ";
+	}
+
+	static void
+	first(FirstSet& set)
+	{
+		PRIMARY::first(set);
+		set.set(NOT_KW);
+		set.set(PLUS_T);
+		set.set(MINUS_T);
+		set.set(OPEN_PAREN_T);
+	}
+
+	static bool
+	nullable()
+	{
+		return PRIMARY::nullable();
+	}
+
+	static bool
+	match (token_iterator &begin, const token_iterator &end, MatchState& state)
+	{
+		Matches builder = { state };
+		return climb(begin, end, builder, ExprPrecedence::NONE + 1);
+	}
+
+	static uint32_t
+	build (token_iterator &begin, const token_iterator &end, FlatTree& tree)
+	{
+		Flat builder = { tree };
+		return climb(begin, end, builder, ExprPrecedence::NONE + 1);
+	}
+
+	static bool
+	parseValue (token_iterator &begin, const token_iterator &end, Value& value)
+	{
+		value.steps.clear();
+		value.operands.clear();
+		value.types.clear();
+		Values builder = { value };
+		return climb(begin, end, builder, ExprPrecedence::NONE + 1);
+	}
+
+	static Expr *
+	parse (token_iterator &begin, const token_iterator &end, ParseContext& context)
+	{
+		return context.parse<Expr>(begin, end, &Expr::parseExpr);
+	}
+
+	static void
+	resume(ResumableParse& parse, ResumableParse::Frame& frame)
+	{
+		if (!frame.state) {
+			if (parse.recall(frame, ruleKey<Expr>())) {
+				return;
+			}
+			frame.state = 1;
+			parse.call(&resumeClimb).level = ExprPrecedence::NONE + 1;
+			return;
+		}
+		Node *node = parse.result();
+		if (!node) {
+			parse.fail();
+			return;
+		}
+		// As in parseExpr, the top has to be an Expr.
+		if (!parse.flags()) {
+			node = new (parse.context()) Expr(OPERAND, token_iterator(), node, 0);
+		}
+		parse.succeed(node);
+	}
+};
+
+} // PGParse
+
+#endif // PGPARSE_EXPR_H
@@ -0,0 +1,200 @@
+#if !defined (PGPARSE_FLAT_TREE_H)
+#define PGPARSE_FLAT_TREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace PGParse {
+
+/**
+ * One node of a FlatTree.  All links are indexes into the tree's node
+ * array, so the array can be copied or written out as it is.
+ */
+struct FlatNode
+{
+	uint32_t kind;
+	uint32_t first_token;	// Token list index of the first token
+	uint32_t end_token;	// and of the one after the last.
+	uint32_t first_child;
+	uint32_t next_sibling;
+};
+
+/**
+ * A parse tree stored as a single array of nodes, as an alternative
+ * to the Node objects built by parse().  Rules fill one in with their
+ * static build() method, and the Lemon grammar with AstBuilder.  Nodes
+ * are mostly in pre-order, but the links are what define the tree: an
+ * Expr operator's node comes after its left operand, and a tree built
+ * by Lemon is entirely bottom up.
+ *
+ * Every rule type is given a kind number the first time it's used;
+ * kindString() turns it back into the rule.  Kind numbers depend on
+ * the order rules are first used in, so a tree written to disk should
+ * be read back by the same program.
+ */
+class FlatTree
+{
+public:
+	static const uint32_t NONE = ~uint32_t(0);
+
+	// What build() returns for an optional rule that matched without
+	// adding a node: a ZeroOrOne with nothing there, or a ZeroOrMore
+	// with no items.  Sequences leave it out of their children.
+	//
+	static const uint32_t EMPTY = NONE - 1;
+
+private:
+	typedef std::string (*RuleString)(int);
+
+	std::vector<FlatNode> nodes_;
+
+	struct Kinds
+	{
+		std::mutex mutex;
+		std::vector<RuleString> rules;
+	};
+
+	static Kinds&
+	kinds()
+	{
+		static Kinds kinds;
+		return kinds;
+	}
+
+	static uint32_t
+	registerKind(RuleString rule)
+	{
+		Kinds& k = kinds();
+		std::lock_guard<std::mutex> lock(k.mutex);
+		k.rules.push_back(rule);
+		return k.rules.size() - 1;
+	}
+
+public:
+	template <class RULE>
+	static uint32_t
+	kind()
+	{
+		static const uint32_t kind = registerKind(&RULE::ruleString);
+		return kind;
+	}
+
+	static std::string
+	kindString(uint32_t kind)
+	{
+		Kinds& k = kinds();
+		RuleString rule;
+		{
+			std::lock_guard<std::mutex> lock(k.mutex);
+			rule = k.rules[kind];
+		}
+		return rule(0);
+	}
+
+	std::size_t
+	size() const
+	{
+		return nodes_.size();
+	}
+
+	const FlatNode *
+	data() const
+	{
+		return nodes_.data();
+	}
+
+	const FlatNode&
+	operator [] (uint32_t index) const
+	{
+		return nodes_[index];
+	}
+
+	void
+	clear()
+	{
+		nodes_.clear();
+	}
+
+	void
+	reserve(std::size_t nodes)
+	{
+		nodes_.reserve(nodes);
+	}
+
+	/**
+	 * Add a node for the single token at 'token'.
+	 */
+	uint32_t
+	leaf(uint32_t kind, std::size_t token)
+	{
+		FlatNode node = { kind, uint32_t(token), uint32_t(token + 1), NONE, NONE };
+		nodes_.push_back(node);
+		return nodes_.size() - 1;
+	}
+
+	/**
+	 * Start a node whose children will begin at 'first_token'.  Its
+	 * end is set by close().
+	 */
+	uint32_t
+	open(uint32_t kind, std::size_t first_token)
+	{
+		FlatNode node = { kind, uint32_t(first_token), uint32_t(first_token), NONE, NONE };
+		nodes_.push_back(node);
+		return nodes_.size() - 1;
+	}
+
+	/**
+	 * Finish the node at 'index', which ends where its last child,
+	 * 'last', does.  A node without children stays empty.
+	 */
+	void
+	close(uint32_t index, uint32_t last)
+	{
+		if (last != NONE) {
+			nodes_[index].end_token = nodes_[last].end_token;
+		}
+	}
+
+	/**
+	 * Set the tokens the node at 'index' covers, for nodes whose
+	 * range doesn't come from a child.
+	 */
+	void
+	span(uint32_t index, std::size_t first_token, std::size_t end_token)
+	{
+		nodes_[index].first_token = first_token;
+		nodes_[index].end_token = end_token;
+	}
+
+	/**
+	 * Add 'child' after 'last', the previous child of 'parent' (or
+	 * NONE for the first child).
+	 */
+	void
+	link(uint32_t parent, uint32_t last, uint32_t child)
+	{
+		if (last == NONE) {
+			nodes_[parent].first_child = child;
+		} else {
+			nodes_[last].next_sibling = child;
+		}
+	}
+
+	/**
+	 * Drop the node at 'index' and everything after it, undoing a
+	 * rule that failed.
+	 */
+	void
+	truncate(uint32_t index)
+	{
+		nodes_.resize(index);
+	}
+};
+
+} // PGParse
+
+#endif // PGPARSE_FLAT_TREE_H
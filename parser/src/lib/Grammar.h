@@ -0,0 +1,368 @@
+#if !defined (PGPARSE_GRAMMAR_H)
+#define PGPARSE_GRAMMAR_H
+
+#include "Expr.h"
+#include "Node.h"
+
+namespace PGParse {
+
+/**
+ * The statements ParserLemon.y covers, as Node.h rules: SELECT, INSERT,
+ * UPDATE and DELETE, and CREATE TABLE, CREATE INDEX, CREATE VIEW, DROP
+ * and ALTER TABLE.  The two grammars accept nearly the same language,
+ * so the engines can be compared on the same input.
+ *
+ * The differences come from parsing top down:
+ *
+ *   - Alternatives are ordered, so keywords are tried before the names
+ *     they could also be.  An UPDATE's table alias needs AS, since
+ *     "UPDATE t SET" would otherwise take SET as the alias.
+ *   - Expressions are Expr's precedence climbing over Operand.  IS,
+ *     ISNULL, NOTNULL, IN, LIKE and BETWEEN bind to the operand just
+ *     before them, tighter than any operator, and LIKE and BETWEEN only
+ *     take a single operand on their right.
+ *   - UNION, INTERSECT and EXCEPT all group to the left at the same
+ *     precedence.
+ *
+ * Rules that refer back to themselves, through subqueries and
+ * expressions in parentheses, are classes declared up front and used
+ * through Ref.  Their ruleString() is just their name; written out in
+ * full everywhere they're used, the grammar's would run to megabytes.
+ */
+namespace Grammar {
+
+struct SelectStmt;
+struct AExpr;
+
+// Names.
+//
+typedef C<IDENTIFIER_TOKEN | KW_IS_UNRESERVED | KW_IS_COL_NAME>		ColId;
+typedef S< ColId, ZeroOrOne< S< T<DOT_T>, ColId > > >			QualifiedName;
+typedef S< ColId, ZeroOrMore< S< T<COMMA_T>, ColId > > >		NameList;
+typedef S< T<OPEN_PAREN_T>, NameList, T<CLOSE_PAREN_T> >		ColumnList;
+typedef S< QualifiedName, ZeroOrMore< S< T<COMMA_T>, QualifiedName > > >	QualifiedNameList;
+
+// Types.
+//
+typedef S< T<OPEN_PAREN_T>, Ref<AExpr>, ZeroOrMore< S< T<COMMA_T>, Ref<AExpr> > >, T<CLOSE_PAREN_T> >
+									TypeModifiers;
+typedef S< OneOf< T<WITH_KW>, T<WITHOUT_KW> >, T<TIME_KW>, T<ZONE_KW> >	TimeZone;
+
+typedef OneOf<
+	S< T<DOUBLE_P_KW>, T<PRECISION_KW> >,
+	S< OneOf< T<CHARACTER_KW>, T<CHAR_P_KW>, T<BIT_KW> >, ZeroOrOne< T<VARYING_KW> >, ZeroOrOne<TypeModifiers> >,
+	S< OneOf< T<TIMESTAMP_KW>, T<TIME_KW> >, ZeroOrOne<TypeModifiers>, ZeroOrOne<TimeZone> >,
+	T<INTERVAL_KW>,
+	S< QualifiedName, ZeroOrOne<TypeModifiers> >
+> 	SimpleTypeName;
+
+typedef S<
+	SimpleTypeName,
+	ZeroOrMore< S< T<OPEN_BRACKET_T>, ZeroOrOne< T<INTEGER_T> >, T<CLOSE_BRACKET_T> > >
+> 	TypeName;
+
+// Operands.
+//
+typedef OneOf< T<STRING_T>, T<UNI_STRING_T>, T<DOLQ_STRING_T> >	Sconst;
+typedef OneOf< C<LITERAL_TOKEN>, T<TRUE_P_KW>, T<FALSE_P_KW>, T<NULL_P_KW> >	Constant;
+typedef S< Ref<AExpr>, ZeroOrMore< S< T<COMMA_T>, Ref<AExpr> > > >	ExprList;
+typedef S< T<OPEN_PAREN_T>, Ref<SelectStmt>, T<CLOSE_PAREN_T> >		Subquery;
+
+typedef S<
+	QualifiedName,
+	T<OPEN_PAREN_T>,
+	ZeroOrOne< OneOf< T<STAR_T>, S< ZeroOrOne< T<DISTINCT_KW> >, ExprList > > >,
+	T<CLOSE_PAREN_T>
+> 	FuncCall;
+
+typedef S< T<WHEN_KW>, Ref<AExpr>, T<THEN_KW>, Ref<AExpr> >		When;
+
+typedef S<
+	T<CASE_KW>,
+	ZeroOrOne< Ref<AExpr> >,
+	When,
+	ZeroOrMore<When>,
+	ZeroOrOne< S< T<ELSE_KW>, Ref<AExpr> > >,
+	T<END_P_KW>
+> 	Case;
+
+typedef OneOf<
+	Constant,
+	T<PARAM_T>,
+	S< T<EXISTS_KW>, Subquery >,
+	S< T<CAST_KW>, T<OPEN_PAREN_T>, Ref<AExpr>, T<AS_KW>, TypeName, T<CLOSE_PAREN_T> >,
+	Case,
+	Subquery,
+	FuncCall,
+	S< QualifiedName, Sconst >,
+	S< ColId, ZeroOrMore< S< T<DOT_T>, OneOf< ColId, T<STAR_T> > > > >
+> 	Primary;
+
+typedef OneOf<
+	S< T<IS_KW>, ZeroOrOne< T<NOT_KW> >, OneOf< T<NULL_P_KW>, T<TRUE_P_KW>, T<FALSE_P_KW> > >,
+	T<ISNULL_KW>,
+	T<NOTNULL_KW>,
+	S< ZeroOrOne< T<NOT_KW> >, OneOf<
+		S< T<IN_P_KW>, T<OPEN_PAREN_T>, OneOf< Ref<SelectStmt>, ExprList >, T<CLOSE_PAREN_T> >,
+		S< OneOf< T<LIKE_KW>, T<ILIKE_KW> >, Primary >,
+		S< T<BETWEEN_KW>, Primary, T<AND_KW>, Primary >
+	> >
+> 	Predicate;
+
+typedef S< Primary, ZeroOrOne<Predicate> >				Operand;
+
+struct AExpr : public Expr<Operand, TypeName>
+{
+	static std::string
+	ruleString(int indent = 0)
+	{
+		return "a_expr";
+	}
+};
+
+// SELECT.
+//
+typedef OneOf<
+	T<STAR_T>,
+	S< AExpr, ZeroOrOne< OneOf< S< T<AS_KW>, ColId >, T<IDENTIFIER_T> > > >
+> 	Target;
+
+typedef S< Target, ZeroOrMore< S< T<COMMA_T>, Target > > >		TargetList;
+typedef OneOf< S< T<AS_KW>, ColId >, T<IDENTIFIER_T> >			Alias;
+
+typedef OneOf<
+	S< Subquery, ZeroOrOne<Alias> >,
+	S< QualifiedName, ZeroOrOne<Alias> >
+> 	TablePrimary;
+
+typedef OneOf<
+	S< OneOf< T<FULL_KW>, T<LEFT_KW>, T<RIGHT_KW> >, ZeroOrOne< T<OUTER_P_KW> > >,
+	T<INNER_P_KW>
+> 	JoinType;
+
+typedef OneOf< S< T<ON_KW>, AExpr >, S< T<USING_KW>, ColumnList > >	JoinQual;
+
+typedef OneOf<
+	S< T<CROSS_KW>, T<JOIN_KW>, TablePrimary >,
+	S< T<NATURAL_KW>, ZeroOrOne<JoinType>, T<JOIN_KW>, TablePrimary >,
+	S< ZeroOrOne<JoinType>, T<JOIN_KW>, TablePrimary, JoinQual >
+> 	Join;
+
+typedef S< TablePrimary, ZeroOrMore<Join> >				TableRef;
+typedef S< TableRef, ZeroOrMore< S< T<COMMA_T>, TableRef > > >		FromList;
+typedef S< T<FROM_KW>, FromList >					FromClause;
+typedef S< T<WHERE_KW>, AExpr >						WhereClause;
+
+typedef OneOf<
+	S< T<DISTINCT_KW>, ZeroOrOne< S< T<ON_KW>, T<OPEN_PAREN_T>, ExprList, T<CLOSE_PAREN_T> > > >,
+	T<ALL_KW>
+> 	Distinct;
+
+typedef S< T<OPEN_PAREN_T>, ExprList, T<CLOSE_PAREN_T> >		Row;
+
+typedef OneOf<
+	S<
+		T<SELECT_KW>,
+		ZeroOrOne<Distinct>,
+		ZeroOrOne<TargetList>,
+		ZeroOrOne<FromClause>,
+		ZeroOrOne<WhereClause>,
+		ZeroOrOne< S< T<GROUP_P_KW>, T<BY_KW>, ExprList > >,
+		ZeroOrOne< S< T<HAVING_KW>, AExpr > >
+	>,
+	S< T<VALUES_KW>, Row, ZeroOrMore< S< T<COMMA_T>, Row > > >,
+	Subquery
+> 	SimpleSelect;
+
+typedef S<
+	OneOf< T<UNION_KW>, T<INTERSECT_KW>, T<EXCEPT_KW> >,
+	ZeroOrOne< OneOf< T<ALL_KW>, T<DISTINCT_KW> > >,
+	SimpleSelect
+> 	SetOperation;
+
+typedef S<
+	AExpr,
+	ZeroOrOne< OneOf< T<ASC_KW>, T<DESC_KW> > >,
+	ZeroOrOne< S< T<NULLS_P_KW>, OneOf< T<FIRST_P_KW>, T<LAST_P_KW> > > >
+> 	SortBy;
+
+typedef S< T<ORDER_KW>, T<BY_KW>, SortBy, ZeroOrMore< S< T<COMMA_T>, SortBy > > >	SortClause;
+
+typedef S< T<LIMIT_KW>, OneOf< T<ALL_KW>, AExpr > >			LimitClause;
+typedef S< T<OFFSET_KW>, AExpr >					OffsetClause;
+
+struct SelectStmt : public S<
+	SimpleSelect,
+	ZeroOrMore<SetOperation>,
+	ZeroOrOne<SortClause>,
+	ZeroOrOne< OneOf< S< LimitClause, ZeroOrOne<OffsetClause> >, S< OffsetClause, ZeroOrOne<LimitClause> > > >
+>
+{
+	static std::string
+	ruleString(int indent = 0)
+	{
+		return "select_stmt";
+	}
+};
+
+// INSERT, UPDATE and DELETE.
+//
+typedef S< T<RETURNING_KW>, TargetList >				Returning;
+
+typedef S<
+	T<INSERT_KW>,
+	T<INTO_KW>,
+	QualifiedName,
+	OneOf< S< T<DEFAULT_KW>, T<VALUES_KW> >, S< ZeroOrOne<ColumnList>, SelectStmt > >,
+	ZeroOrOne<Returning>
+> 	InsertStmt;
+
+typedef S< ColId, T<EQUAL_T>, OneOf< T<DEFAULT_KW>, AExpr > >		SetClause;
+
+typedef S<
+	T<UPDATE_KW>,
+	QualifiedName,
+	ZeroOrOne< S< T<AS_KW>, ColId > >,
+	T<SET_KW>,
+	SetClause,
+	ZeroOrMore< S< T<COMMA_T>, SetClause > >,
+	ZeroOrOne<FromClause>,
+	ZeroOrOne<WhereClause>,
+	ZeroOrOne<Returning>
+> 	UpdateStmt;
+
+typedef S<
+	T<DELETE_P_KW>,
+	T<FROM_KW>,
+	QualifiedName,
+	ZeroOrOne<Alias>,
+	ZeroOrOne< S< T<USING_KW>, FromList > >,
+	ZeroOrOne<WhereClause>,
+	ZeroOrOne<Returning>
+> 	DeleteStmt;
+
+// CREATE TABLE, CREATE INDEX and CREATE VIEW.  CREATE is factored out,
+// so which one it is is decided by the next token.
+//
+typedef OneOf<
+	T<CASCADE_KW>,
+	T<RESTRICT_KW>,
+	S< T<NO_KW>, T<ACTION_KW> >,
+	S< T<SET_KW>, OneOf< T<NULL_P_KW>, T<DEFAULT_KW> > >
+> 	KeyAction;
+
+typedef S<
+	T<REFERENCES_KW>,
+	QualifiedName,
+	ZeroOrOne<ColumnList>,
+	ZeroOrMore< S< T<ON_KW>, OneOf< T<DELETE_P_KW>, T<UPDATE_KW> >, KeyAction > >
+> 	References;
+
+typedef S< T<CHECK_KW>, T<OPEN_PAREN_T>, AExpr, T<CLOSE_PAREN_T> >	Check;
+typedef S< T<CONSTRAINT_KW>, ColId >					ConstraintName;
+
+typedef S< ZeroOrOne<ConstraintName>, OneOf<
+	S< T<NOT_KW>, T<NULL_P_KW> >,
+	T<NULL_P_KW>,
+	T<UNIQUE_KW>,
+	S< T<PRIMARY_KW>, T<KEY_KW> >,
+	Check,
+	S< T<DEFAULT_KW>, AExpr >,
+	References
+> > 	ColumnConstraint;
+
+typedef S< ZeroOrOne<ConstraintName>, OneOf<
+	S< T<UNIQUE_KW>, ColumnList >,
+	S< T<PRIMARY_KW>, T<KEY_KW>, ColumnList >,
+	Check,
+	S< T<FOREIGN_KW>, T<KEY_KW>, ColumnList, References >
+> > 	TableConstraint;
+
+typedef S< ColId, TypeName, ZeroOrMore<ColumnConstraint> >		ColumnDef;
+typedef OneOf< TableConstraint, ColumnDef >				TableElement;
+typedef OneOf< T<TEMPORARY_KW>, T<TEMP_KW> >				Temp;
+
+typedef S<
+	ZeroOrOne<Temp>,
+	T<TABLE_KW>,
+	ZeroOrOne< S< T<IF_P_KW>, T<NOT_KW>, T<EXISTS_KW> > >,
+	QualifiedName,
+	T<OPEN_PAREN_T>,
+	ZeroOrOne< S< TableElement, ZeroOrMore< S< T<COMMA_T>, TableElement > > > >,
+	T<CLOSE_PAREN_T>
+> 	CreateTable;
+
+typedef S<
+	OneOf< ColId, S< T<OPEN_PAREN_T>, AExpr, T<CLOSE_PAREN_T> > >,
+	ZeroOrOne< OneOf< T<ASC_KW>, T<DESC_KW> > >
+> 	IndexElement;
+
+typedef S<
+	ZeroOrOne< T<UNIQUE_KW> >,
+	T<INDEX_KW>,
+	ZeroOrOne<ColId>,
+	T<ON_KW>,
+	QualifiedName,
+	T<OPEN_PAREN_T>,
+	IndexElement,
+	ZeroOrMore< S< T<COMMA_T>, IndexElement > >,
+	T<CLOSE_PAREN_T>,
+	ZeroOrOne<WhereClause>
+> 	CreateIndex;
+
+typedef S<
+	ZeroOrOne< S< T<OR_KW>, T<REPLACE_KW> > >,
+	ZeroOrOne<Temp>,
+	T<VIEW_KW>,
+	QualifiedName,
+	ZeroOrOne<ColumnList>,
+	T<AS_KW>,
+	SelectStmt
+> 	CreateView;
+
+typedef S< T<CREATE_KW>, OneOf< CreateTable, CreateIndex, CreateView > >	CreateStmt;
+
+// DROP and ALTER TABLE.
+//
+typedef OneOf< T<CASCADE_KW>, T<RESTRICT_KW> >				DropBehavior;
+
+typedef S<
+	T<DROP_KW>,
+	OneOf< T<TABLE_KW>, T<VIEW_KW>, T<INDEX_KW> >,
+	ZeroOrOne< S< T<IF_P_KW>, T<EXISTS_KW> > >,
+	QualifiedNameList,
+	ZeroOrOne<DropBehavior>
+> 	DropStmt;
+
+typedef OneOf<
+	S< T<ADD_P_KW>, OneOf< TableConstraint, S< ZeroOrOne< T<COLUMN_KW> >, ColumnDef > > >,
+	S< T<DROP_KW>, ZeroOrOne< T<COLUMN_KW> >, ColId, ZeroOrOne<DropBehavior> >,
+	S< T<RENAME_KW>, T<TO_KW>, ColId >,
+	S< T<RENAME_KW>, ZeroOrOne< T<COLUMN_KW> >, ColId, T<TO_KW>, ColId >
+> 	AlterTableCmd;
+
+typedef S<
+	T<ALTER_KW>,
+	T<TABLE_KW>,
+	QualifiedName,
+	AlterTableCmd,
+	ZeroOrMore< S< T<COMMA_T>, AlterTableCmd > >
+> 	AlterTableStmt;
+
+// A statement, and one ended by a semi-colon as StatementStream wants.
+//
+typedef OneOf<
+	SelectStmt,
+	InsertStmt,
+	UpdateStmt,
+	DeleteStmt,
+	CreateStmt,
+	DropStmt,
+	AlterTableStmt
+> 	Stmt;
+
+typedef S< Stmt, T<SEMI_COLON_T> >					Statement;
+
+} } // PGParse::Grammar
+
+#endif // PGPARSE_GRAMMAR_H
@@ -0,0 +1,176 @@
+#if !defined (PGPARSE_HANDCRAFTED_H)
+#define PGPARSE_HANDCRAFTED_H
+
+#include "Token.h"
+#include <list>
+
+namespace PGParse {
+
+class Statement
+{
+public:
+	virtual ~Statement() {}
+};
+
+class DropTableStatement : public Statement
+{
+public:
+	DropTableStatement(TokenList::const_iterator table_name_) : table_name(table_name_)
+	{}
+
+	TokenList::const_iterator table_name;
+};
+
+class StatementBlock
+{
+public:
+	std::list<Statement*> statements;
+};
+
+/**
+ * A really simple recursive descent parser that takes advantage
+ * of templates to eliminate boilerplate code.
+ *
+ * This was the first try at a parser, before Node.h.  It only knows
+ * DROP TABLE, and is kept to compare against: handcrafted.C runs it,
+ * and the bench runs it over the DROP TABLE statements of its corpus.
+ */
+class Parser
+{
+public:
+	typedef TokenList::const_iterator iterator;
+	struct Frame;
+private:
+	std::list<Frame*> frames;
+	iterator current_;
+	iterator end_;
+public:
+	Parser(
+		iterator begin,
+		const iterator& end
+	):	current_(begin), end_(end)
+	{}
+
+	~Parser()
+	{
+		while(frames.size()) {
+			end_frame();
+		}
+	}
+
+	struct Frame
+	{
+		Frame(iterator& begin_) : begin(begin_) {}
+
+		iterator begin;
+	};
+
+	void
+	start_frame()
+	{
+		frames.push_back(new Frame(current_));
+	}
+
+	void
+	end_frame()
+	{
+		Frame * frame = frames.back();
+		frames.pop_back();
+		delete frame;
+	}
+
+	void
+	abort_frame()
+	{
+		Frame * frame = frames.back();
+		frames.pop_back();
+		current_ = frame->begin;
+		delete frame;
+	}
+
+	// Whether all the tokens have been parsed.
+	//
+	bool
+	done() const
+	{
+		return current_ == end_;
+	}
+
+	bool
+	token(PGParse::TokenId token_id, iterator* out = 0)
+	{
+		if (current_ == end_ || current_->id() != token_id) {
+			return false;
+		}
+		if (out) {
+			*out = current_;
+		}
+		current_ ++;
+		return true;
+	}
+
+	template<class ITEM>
+	bool
+	parse(iterator *out = 0)
+	{
+		ITEM p;
+		return p(current_, end_, out);
+	}
+
+	template <PGParse::TokenId ID>
+	class T
+	{
+	public:
+		bool
+		operator () (iterator& current, const iterator& end, iterator* out = 0)
+		{
+			if (current == end || current->id() != ID) {
+				return false;
+			}
+			if (out) {
+				*out = current;
+			}
+			current ++;
+			return true;
+		}
+	};
+
+	bool
+	drop_table(Statement **out)
+	{
+		start_frame();
+		iterator identifier;
+		if (
+			parse< T<DROP_KW> >()
+			&& parse< T<TABLE_KW> >()
+			&& parse< T<IDENTIFIER_T> >(&identifier)
+		) {
+			end_frame();
+			*out = new DropTableStatement(identifier);
+			return true;
+		}
+		abort_frame();
+		return false;
+	}
+
+	bool
+	statement(Statement** out)
+	{
+		Statement *out_ = 0;
+		start_frame();
+		if (drop_table(&out_)) {
+			if (token(SEMI_COLON_T)) {
+				end_frame();
+				*out = out_;
+				return true;
+			}
+			delete out_;
+		}
+		abort_frame();
+		return false;
+	}
+};
+
+} // PGParse
+
+#endif // PGPARSE_HANDCRAFTED_H
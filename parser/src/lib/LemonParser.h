@@ -0,0 +1,194 @@
+#if !defined (PGPARSE_LEMON_PARSER_H)
+#define PGPARSE_LEMON_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Ast.h"
+#include "Token.h"
+
+// Defined by the parser Lemon generates from ParserLemon.y.
+//
+void *ParseAlloc(void *(*malloc_proc)(std::size_t));
+void Parse(void *parser, int token_id, uint32_t token, PGParse::AstBuilder *ast);
+void ParseFree(void *parser, void (*free_proc)(void *));
+
+namespace PGParse {
+
+/**
+ * A Lemon parser and the tree it builds, set up once and reused for
+ * statement after statement.
+ *
+ * Parsing a statement allocates nothing once the parser is warm.  The
+ * grammar's stack has a fixed depth (%stack_size in ParserLemon.y) and
+ * is part of the parser, and the semantic values on it are token and
+ * node indexes rather than objects.  The nodes themselves go in the
+ * FlatTree, whose storage is kept from one statement to the next and
+ * only grows, so it serves as the arena for every statement's values.
+ *
+ * Tokens are pushed one at a time with push(), then finish() says
+ * whether the statement parsed and leaves its tree in tree() until
+ * reset().  parse() does all three for a statement from a token list.
+ * reset() can also abandon a statement part way through.
+ *
+ * A LemonParser is used by one thread at a time; see LemonParserPool.
+ */
+class LemonParser
+{
+private:
+	void *parser_;
+	FlatTree tree_;
+	AstBuilder ast_;
+	bool open_;
+
+	LemonParser(const LemonParser&);
+	LemonParser& operator=(const LemonParser&);
+
+public:
+	explicit
+	LemonParser(std::size_t nodes = 256)
+		: parser_(ParseAlloc(std::malloc)), tree_(), ast_(tree_), open_(false)
+	{
+		tree_.reserve(nodes);
+	}
+
+	~LemonParser()
+	{
+		ParseFree(parser_, std::free);
+	}
+
+	void
+	push(const Token& token, uint32_t index)
+	{
+		if (ast_.failed) {
+			return;
+		}
+		int lemon_id = lemonId(token.id());
+		if (lemon_id < 0) {
+			if (!token.is(TOKEN_IS_IGNORED)) {
+				open_ = true;
+				ast_.syntaxError(index);
+			}
+			return;
+		}
+		open_ = true;
+		Parse(parser_, lemon_id, index, &ast_);
+	}
+
+	// End the statement, and say whether it parsed.
+	//
+	bool
+	finish()
+	{
+		// The end of input also puts the parser back in its start
+		// state after a syntax error.
+		Parse(parser_, 0, 0, &ast_);
+		open_ = false;
+		return !ast_.failed;
+	}
+
+	void
+	reset()
+	{
+		if (open_) {
+			finish();
+		}
+		tree_.clear();
+		ast_.reset();
+	}
+
+	bool
+	parse(TokenList::const_iterator begin, const TokenList::const_iterator& end)
+	{
+		reset();
+		for (; begin != end && !ast_.failed; begin ++) {
+			push(*begin, begin.index());
+		}
+		return finish();
+	}
+
+	// Whether any tokens have been pushed since the last finish().
+	//
+	bool
+	open() const
+	{
+		return open_;
+	}
+
+	const AstBuilder&
+	ast() const
+	{
+		return ast_;
+	}
+
+	const FlatTree&
+	tree() const
+	{
+		return tree_;
+	}
+};
+
+/**
+ * Parsers kept ready for whichever thread needs one, for a server
+ * handling many short queries: taking one from the pool and giving it
+ * back costs a lock, where making a new one costs an allocation and a
+ * cold tree.
+ *
+ *	std::unique_ptr<LemonParser> parser = pool.acquire();
+ *	parser->parse(begin, end);
+ *	...
+ *	pool.release(std::move(parser));
+ *
+ * The pool makes new parsers when it runs out, and keeps everything
+ * given back to it.
+ */
+class LemonParserPool
+{
+private:
+	std::mutex mutex_;
+	std::vector< std::unique_ptr<LemonParser> > free_;
+	std::size_t nodes_;
+
+	LemonParserPool(const LemonParserPool&);
+	LemonParserPool& operator=(const LemonParserPool&);
+
+public:
+	explicit
+	LemonParserPool(std::size_t parsers = 0, std::size_t nodes = 256)
+		: nodes_(nodes)
+	{
+		for (std::size_t i = 0; i < parsers; i ++) {
+			free_.push_back(std::unique_ptr<LemonParser>(new LemonParser(nodes_)));
+		}
+	}
+
+	std::unique_ptr<LemonParser>
+	acquire()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!free_.empty()) {
+				std::unique_ptr<LemonParser> ret = std::move(free_.back());
+				free_.pop_back();
+				return ret;
+			}
+		}
+		return std::unique_ptr<LemonParser>(new LemonParser(nodes_));
+	}
+
+	void
+	release(std::unique_ptr<LemonParser> parser)
+	{
+		parser->reset();
+		std::lock_guard<std::mutex> lock(mutex_);
+		free_.push_back(std::move(parser));
+	}
+};
+
+} // PGParse
+
+#endif // PGPARSE_LEMON_PARSER_H
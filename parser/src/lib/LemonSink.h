@@ -0,0 +1,120 @@
+#if !defined (PGPARSE_LEMON_SINK_H)
+#define PGPARSE_LEMON_SINK_H
+
+#include <cstddef>
+
+#include "LemonParser.h"
+#include "Token.h"
+
+namespace PGParse {
+
+/**
+ * Feeds tokens into a LemonParser as the scanner finds them, so that
+ * no token list is built:
+ *
+ *	LemonSink sink(parser);
+ *	scanner.scan(bytes, length, sink);
+ *	sink.finish();
+ *
+ * Statements end at semi-colons outside parentheses, where
+ * StatementStream resynchronizes, and each is parsed on its own so a
+ * syntax error only costs the rest of its statement.  statement() is
+ * called at the end of each one, while the parser still holds its
+ * result; the parser is reset for the next.  Token values in the tree
+ * are sink indexes, which are what the token list indexes would have
+ * been.
+ *
+ * A LemonSink, like a Scanner, belongs to one thread, so to parse on
+ * every core give each thread its own pair.  Everything they share is
+ * either constant (the token tables) or locked (FlatTree's kinds, and
+ * LemonParserPool).
+ */
+class LemonSink : public TokenSink
+{
+private:
+	LemonParser& parser_;
+	int depth_;
+	std::size_t statements_;
+	std::size_t accepted_;
+
+	LemonSink(const LemonSink&);
+	LemonSink& operator=(const LemonSink&);
+
+	void
+	endStatement()
+	{
+		if (parser_.open()) {
+			bool ok = parser_.finish();
+			statements_ ++;
+			accepted_ += ok;
+			statement();
+		}
+		parser_.reset();
+		depth_ = 0;
+	}
+
+protected:
+	// Called once each statement has been parsed.
+	//
+	virtual void
+	statement()
+	{}
+
+public:
+	explicit
+	LemonSink(LemonParser& parser)
+		: parser_(parser),
+		  depth_(0),
+		  statements_(0),
+		  accepted_(0)
+	{
+		parser_.reset();
+	}
+
+	void
+	token(const Token& token, std::size_t index)
+	{
+		TokenId id = token.id();
+		if (id == OPEN_PAREN_T) {
+			depth_ ++;
+		} else if (id == CLOSE_PAREN_T) {
+			if (depth_ > 0) {
+				depth_ --;
+			}
+		} else if (id == SEMI_COLON_T && depth_ == 0) {
+			endStatement();
+			return;
+		}
+		parser_.push(token, index);
+	}
+
+	// End the last statement, if it had no semi-colon.
+	//
+	void
+	finish()
+	{
+		endStatement();
+	}
+
+	const LemonParser&
+	parser() const
+	{
+		return parser_;
+	}
+
+	std::size_t
+	statements() const
+	{
+		return statements_;
+	}
+
+	std::size_t
+	accepted() const
+	{
+		return accepted_;
+	}
+};
+
+} // PGParse
+
+#endif // PGPARSE_LEMON_SINK_H
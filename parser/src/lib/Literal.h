@@ -0,0 +1,69 @@
+#if !defined (PGPARSE_LITERAL_H)
+#define PGPARSE_LITERAL_H
+
+#include <cstddef>
+#include <string>
+
+#include "TokenId.h"
+
+namespace PGParse {
+
+/**
+ * Decoding of literal bodies that the scanner has already delimited.
+ *
+ * The decoders append their output to 'out' and return either the
+ * 'ok' token id that was passed in, or the id of the error token
+ * that should be emitted instead.  On error, 'out' may contain a
+ * partially decoded value; it's up to the caller to discard it.
+ */
+
+/**
+ * Decode the body of a U&'...' string or a U&"..." identifier to UTF-8.
+ *
+ * 'body' is the text between the opening and closing quotes.  Doubled
+ * quotes collapse to a single quote, and for strings the quote
+ * continuation syntax ('abc'<newline>'def') is removed.  Escapes are
+ * \XXXX and \+XXXXXX (with '\' replaced by the UESCAPE character),
+ * and UTF-16 surrogate pairs must be written as two adjacent escapes.
+ */
+TokenId		decodeUnicodeEscapes	(
+			const char *body,
+			std::size_t len,
+			char quote,
+			char escape,
+			TokenId ok,
+			std::string& out
+		);
+
+/**
+ * Validate and pack the body of a B'...' literal.  Bits are packed
+ * most significant first, and a final partial byte is padded with
+ * zero bits; the bit count is the length of the body.
+ */
+TokenId		decodeBitString		(
+			const char *body,
+			std::size_t len,
+			TokenId ok,
+			std::string& out
+		);
+
+/**
+ * Validate and pack the body of an X'...' literal.  An odd number of
+ * digits is allowed (X'abc' is a 12-bit string), in which case the
+ * last byte holds the final digit in its high nibble.
+ */
+TokenId		decodeHexString		(
+			const char *body,
+			std::size_t len,
+			TokenId ok,
+			std::string& out
+		);
+
+/**
+ * Append the UTF-8 encoding of 'code' to 'out'.
+ */
+void		appendUtf8		(unsigned long code, std::string& out);
+
+} // PGParse
+
+#endif // PGPARSE_LITERAL_H
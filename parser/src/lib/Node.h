@@ -1,418 +1,2379 @@
 #if !defined( PGPARSE_NODE_H )
 #define PGPARSE_NODE_H
 
+#include "Arena.h"
+#include "FlatTree.h"
+#include "Profile.h"
+#include "Writer.h"
 #include "Scanner.h"
 #include <cstring>
 #include <ctype.h>
-#include <list>
-#include <loki/Sequence.h>
-#include <loki/HierarchyGenerators.h>
+#include <bitset>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <boost/optional.hpp>
+#include <boost/variant.hpp>
 
 namespace PGParse {
 	
 typedef TokenList::const_iterator token_iterator;
 
+class Node;
+class NodeVisitor;
+
+/**
+ * One address per rule type, for telling rules apart at run time.
+ */
+template <class RULE>
+const void *
+ruleKey()
+{
+	static const char key = 0;
+	return &key;
+}
+
+/**
+ * State shared by all the rules during one parse.
+ *
+ * Nodes are allocated from the context's arena, so a tree lives exactly
+ * as long as the context that produced it (or until clear()).  Rules
+ * that fail give back whatever they allocated with rewind(), so
+ * abandoned alternatives cost nothing to clean up.
+ *
+ * The context also holds the packrat memo table: the result of each
+ * sequence and choice at each token position, success or failure, is
+ * recorded the first time it's computed, as long as some choice further
+ * up still has other alternatives to try.  Alternatives that share
+ * sub-rules then never parse the same tokens twice, which keeps
+ * parse time linear in the number of tokens.  Since nodes are never
+ * owned by their parents, a memoized node can appear in any number of
+ * candidate trees.
+ */
+class ParseContext
+{
+private:
+	struct MemoKey
+	{
+		const void *rule;
+		std::size_t index;
+
+		bool
+		operator == (const MemoKey& other) const
+		{
+			return rule == other.rule && index == other.index;
+		}
+	};
+
+	struct MemoHash
+	{
+		std::size_t
+		operator () (const MemoKey& key) const
+		{
+			return std::hash<const void *>()(key.rule) ^ (key.index * 0x9E3779B97F4A7C15ULL);
+		}
+	};
+
+	struct MemoEntry
+	{
+		Node *node;
+		token_iterator end;
+	};
+
+	typedef std::unordered_map<MemoKey, MemoEntry, MemoHash> Memo;
+
+	Memo memo_;
+
+	// Memoized nodes must survive a rewind past the point where they
+	// were allocated, so rewinds never go below this.
+	//
+	Arena::Mark pinned_;
+
+	// How many choices on the way down to the current rule still have
+	// alternatives left to try.  While there are none, no result is
+	// recorded: nothing will go back and parse the same tokens again.
+	//
+	std::size_t backtrack_points_;
+
+public:
+	ParseContext() : memo_(), pinned_(), backtrack_points_(0), memoize(true), arena()
+	{
+		pinned_ = arena.mark();
+	}
+
+	/**
+	 * Marks a choice as having more alternatives to try, for as long
+	 * as it's in scope.
+	 */
+	class BacktrackPoint
+	{
+	private:
+		ParseContext& context_;
+		bool active_;
+
+		BacktrackPoint(const BacktrackPoint&);
+		BacktrackPoint& operator=(const BacktrackPoint&);
+
+	public:
+		BacktrackPoint(ParseContext& context, bool active)
+			: context_(context), active_(active)
+		{
+			if (active_) {
+				context_.backtrack_points_ ++;
+			}
+		}
+
+		~BacktrackPoint()
+		{
+			if (active_) {
+				context_.backtrack_points_ --;
+			}
+		}
+	};
+
+	// Turn this off for grammars without much backtracking, where
+	// the table costs more than it saves.  LL(1) choices never
+	// backtrack, so a grammar made only of those doesn't use the
+	// table either way.
+	//
+	bool memoize;
+	Arena arena;
+
+	void
+	rewind(const Arena::Mark& mark)
+	{
+		if (mark.after(pinned_)) {
+			arena.rewind(mark);
+		} else {
+			arena.rewind(pinned_);
+		}
+	}
+
+	/**
+	 * Forget all nodes and memoized results, keeping the memory
+	 * for the next parse.
+	 */
+	void
+	clear()
+	{
+		memo_.clear();
+		arena.clear();
+		pinned_ = arena.mark();
+		backtrack_points_ = 0;
+	}
+
+	/**
+	 * Parse RULE at 'begin' with the given function, or reuse the
+	 * result from an earlier attempt at the same position.
+	 */
+	template <class RULE>
+	RULE *
+	parse(
+		token_iterator &begin,
+		const token_iterator &end,
+		RULE *(*parser)(token_iterator &, const token_iterator &, ParseContext &)
+	)
+	{
+		if (!memoize) {
+			return parser(begin, end, *this);
+		}
+		Node *node;
+		if (recall(ruleKey<RULE>(), begin, node)) {
+			return static_cast<RULE *>(node);
+		}
+		std::size_t index = begin.index();
+		RULE *ret = parser(begin, end, *this);
+		remember(ruleKey<RULE>(), index, ret, begin);
+		return ret;
+	}
+
+	/**
+	 * The memoized result of 'rule' at 'begin', if there is one, for
+	 * parsers that don't call parse().  'begin' moves to its end if it
+	 * was a success.
+	 */
+	bool
+	recall(const void *rule, token_iterator &begin, Node *&node) const
+	{
+		if (!memoize) {
+			return false;
+		}
+		MemoKey key = { rule, begin.index() };
+		Memo::const_iterator i = memo_.find(key);
+		if (i == memo_.end()) {
+			return false;
+		}
+		node = i->second.node;
+		if (node) {
+			begin = i->second.end;
+		}
+		return true;
+	}
+
+	/**
+	 * Record the result of 'rule' at the token with the given index,
+	 * which is 0 for a failure, if any choice could still backtrack.
+	 */
+	void
+	remember(const void *rule, std::size_t index, Node *node, const token_iterator &end)
+	{
+		if (!memoize || !backtrack_points_) {
+			return;
+		}
+		MemoKey key = { rule, index };
+		MemoEntry entry = { node, end };
+		memo_.insert(std::make_pair(key, entry));
+		if (node) {
+			pinned_ = arena.mark();
+		}
+	}
+
+	// What a BacktrackPoint does, for a parser that can't keep one in
+	// scope while the choice is open.
+	//
+	void
+	addBacktrackPoint()
+	{
+		backtrack_points_ ++;
+	}
+
+	void
+	removeBacktrackPoint()
+	{
+		backtrack_points_ --;
+	}
+};
+
+/**
+ * The token ids a rule can start with.
+ */
+typedef std::bitset<FINAL_SENTINAL> FirstSet;
+
+/**
+ * What a recognize-only match() found out about the input besides
+ * whether it matched: the furthest token at which any rule failed.
+ * For input that doesn't match that's usually where the error is.
+ */
+struct MatchState
+{
+	bool failed;
+	token_iterator furthest;
+
+	MatchState() : failed(false), furthest()
+	{}
+
+	void
+	fail(const token_iterator& at)
+	{
+		if (!failed || at.index() > furthest.index()) {
+			furthest = at;
+			failed = true;
+		}
+	}
+};
+
+/**
+ * A parse that takes its tokens as they come, instead of needing them
+ * all up front.  parse() keeps its place on the C++ stack as it
+ * recurses; this keeps it in a stack of frames instead, one for each
+ * rule in progress, so it can stop when it runs out of tokens and go on
+ * from the same place when there are more.
+ *
+ * Each rule type's resume() takes its frame a step further: it looks
+ * at the next token, starts a child rule with call(), or ends with
+ * succeed() or fail().  When a child ends, its parent is resumed and
+ * finds what the child got in result().  If the next token hasn't
+ * arrived, ready() says so and the rule returns, to be resumed in the
+ * same state once it has.
+ *
+ * The steps are the ones parse() takes, in the same order, and they
+ * build the same nodes in the context's arena with the same memo
+ * table.  Tokens are only gone over again where parse() would go over
+ * them again, when an alternative fails after taking some and the next
+ * starts from the same token.  The memo table keeps the sequences and
+ * choices inside them from being parsed twice, though there's no
+ * SharedPrefix, so leading tokens are.  Otherwise a new token costs
+ * what parsing that token costs, however long the input before it.
+ */
+class ResumableParse
+{
+public:
+	struct Frame;
+
+	typedef void (*Resume)(ResumableParse &, Frame &);
+
+	/**
+	 * A rule in progress.  'state' and the fields after it are for
+	 * the rule to use as it likes, and start out as zero.
+	 */
+	struct Frame
+	{
+		Resume resume;
+		const void *rule;	// The memo key, for rules that are memoized
+		std::size_t start;	// The index of the token the rule started at
+		Arena::Mark mark;	// What to give back if it fails
+		int state;
+		int level;
+		std::size_t index;
+		std::size_t token;
+		Node *node;
+	};
+
+private:
+	ParseContext& context_;
+	const TokenList& tokens_;
+	std::vector<Frame> frames_;
+	std::size_t position_;
+	bool ended_;
+	bool waiting_;
+	Node *result_;
+	int flags_;
+	MatchState state_;
+
+	ResumableParse(const ResumableParse&);
+	ResumableParse& operator=(const ResumableParse&);
+
+	void
+	end(Node *node, int flags)
+	{
+		const Frame& frame = frames_.back();
+		if (frame.rule) {
+			context_.remember(frame.rule, frame.start, node, iterator(position_));
+		}
+		frames_.pop_back();
+		result_ = node;
+		flags_ = flags;
+	}
+
+public:
+	/**
+	 * A parse of 'tokens', which can have more added to the end
+	 * between calls to run().  Iterators in the nodes refer to it.
+	 */
+	ResumableParse(ParseContext& context, const TokenList& tokens)
+		: context_(context), tokens_(tokens), frames_(), position_(0), ended_(false),
+		waiting_(false), result_(0), flags_(0), state_()
+	{}
+
+	/**
+	 * Start parsing RULE at the first token, dropping any parse in
+	 * progress.  Its nodes aren't given back, so the context should
+	 * be cleared first.
+	 */
+	template <class RULE>
+	void
+	start()
+	{
+		frames_.clear();
+		position_ = 0;
+		ended_ = false;
+		result_ = 0;
+		flags_ = 0;
+		state_ = MatchState();
+		call(&RULE::resume);
+	}
+
+	/**
+	 * Go as far as the tokens so far allow, with 'ended' saying
+	 * whether that's all of them.  Returns whether the rule is done,
+	 * with result() its node or 0 if it failed, and position() where
+	 * it ended.  Once 'ended' is true, the rule is always done.
+	 */
+	bool
+	run(bool ended)
+	{
+		ended_ = ended;
+		waiting_ = false;
+		while (!frames_.empty() && !waiting_) {
+			Frame& frame = frames_.back();
+			frame.resume(*this, frame);
+		}
+		return frames_.empty();
+	}
+
+	// Where the furthest failure was, as a MatchState would have it
+	// after match().
+	//
+	const MatchState&
+	state() const
+	{
+		return state_;
+	}
+
+	// What follows is for the rules.
+	//
+
+	ParseContext&
+	context()
+	{
+		return context_;
+	}
+
+	/**
+	 * Whether the next token is known, or known not to be coming.  If
+	 * not, the rule should return without changing its state.
+	 */
+	bool
+	ready()
+	{
+		if (position_ < tokens_.size() || ended_) {
+			return true;
+		}
+		waiting_ = true;
+		return false;
+	}
+
+	// Once ready(), the next token, or 0 at the end of the input.
+	//
+	const Token *
+	token() const
+	{
+		return position_ < tokens_.size() ? &tokens_[position_] : 0;
+	}
+
+	std::size_t
+	position() const
+	{
+		return position_;
+	}
+
+	token_iterator
+	iterator(std::size_t index) const
+	{
+		return tokens_.at(index);
+	}
+
+	void
+	advance()
+	{
+		position_ ++;
+	}
+
+	// Go back to an earlier token without failing, for rules that try
+	// something and then do without it.
+	//
+	void
+	backtrack(std::size_t position)
+	{
+		position_ = position;
+	}
+
+	// Note that something couldn't be matched at the current token,
+	// where match() would call MatchState::fail().
+	//
+	void
+	expected()
+	{
+		state_.fail(iterator(position_));
+	}
+
+	/**
+	 * Start a child rule at the current token, 'resume' being its
+	 * rule's resume().  The caller should set its own state first and
+	 * return straight after, since its frame may move; the child's is
+	 * returned for setting up.
+	 */
+	Frame&
+	call(Resume resume)
+	{
+		Frame frame = { resume, 0, position_, context_.arena.mark(), 0, 0, 0, 0, 0 };
+		frames_.push_back(frame);
+		return frames_.back();
+	}
+
+	/**
+	 * For memoized rules, as they start: if the memo table has the
+	 * result of 'rule' at this token, end with it and return true.
+	 * Otherwise the result is recorded when the rule ends.
+	 */
+	bool
+	recall(Frame& frame, const void *rule)
+	{
+		token_iterator begin = iterator(position_);
+		Node *node;
+		if (context_.recall(rule, begin, node)) {
+			position_ = begin.index();
+			end(node, 0);
+			return true;
+		}
+		frame.rule = rule;
+		return false;
+	}
+
+	// End the rule at the top with 'node'.  'flags' go to its parent
+	// with it, for rules made of more than one kind of frame.
+	//
+	void
+	succeed(Node *node, int flags = 0)
+	{
+		end(node, flags);
+	}
+
+	// End the rule at the top with a failure, going back to its first
+	// token and giving back what it allocated.
+	//
+	void
+	fail()
+	{
+		const Frame& frame = frames_.back();
+		position_ = frame.start;
+		context_.rewind(frame.mark);
+		end(0, 0);
+	}
+
+	// What the child that just ended got, and its flags.
+	//
+	Node *
+	result() const
+	{
+		return result_;
+	}
+
+	int
+	flags() const
+	{
+		return flags_;
+	}
+};
+
+/**
+ * The Value types that parseValue() fills in, as an alternative to
+ * a tree of Nodes:
+ *
+ *   T<>, C<>		token_iterator, pointing at the token
+ *   S<A, B, ...>	std::tuple<A::Value, B::Value, ...>
+ *   OneOf<A, B, ...>	boost::variant<Alt<0, A::Value>, Alt<1, B::Value>, ...>
+ *   ZeroOrMore<A>	std::vector<A::Value>
+ *   ZeroOrOne<A>	boost::optional<A::Value>
+ *   Ref<A>		A::Value, kept on the heap; see Ref
+ *
+ * Values are ordinary copyable objects: no virtual functions, and no
+ * allocation except by the vectors and Refs.  The Alt wrapper keeps
+ * alternatives with the same Value type apart; which() on the variant
+ * is the index of the alternative that matched.  boost::variant takes at most
+ * BOOST_MPL_LIMIT_LIST_SIZE (normally 20) types, so a OneOf with more
+ * alternatives than that can still parse() but not parseValue().
+ */
+template <std::size_t I, class VALUE>
+struct Alt
+{
+	VALUE value;
+};
+
+/**
+ * Base class for all parse tree nodes.
+ *
+ * Each rule type also provides these static members, which the
+ * combinators below rely on:
+ *
+ *   parse(begin, end, context)  Match the rule at 'begin', returning a
+ *                               node or 0.  On failure 'begin' must be
+ *                               left unchanged.
+ *   ruleString()                The rule in a readable EBNF-ish form.
+ *   match(begin, end, state)    Like parse, but only says whether the
+ *                               rule matches, building nothing.
+ *   build(begin, end, tree)     Like parse, but adds the nodes to a
+ *                               FlatTree, returning the index of the
+ *                               rule's node, FlatTree::EMPTY if it
+ *                               matched without one, or FlatTree::NONE.
+ *   parseValue(begin, end, v)   Like parse, but fills in 'v', a plain
+ *                               value of the rule's Value type.
+ *   first(set)                  Add the ids of the tokens the rule can
+ *                               start with to 'set'.
+ *   nullable()                  Whether the rule can match no tokens.
+ *   resume(parse, frame)        Take the rule a step further in a
+ *                               ResumableParse; see there.
+ */
 class Node
 {
 public:
 	virtual 
 	~Node()
 	{}
+
+	static void *
+	operator new(std::size_t size, ParseContext& context)
+	{
+		return context.arena.allocate(size);
+	}
+
+	// Only used if a constructor throws.
+	static void
+	operator delete(void *, ParseContext&)
+	{}
+
+	// Nodes live in an arena, so there's nothing to free.
+	static void
+	operator delete(void *)
+	{}
+	
+	/**
+	 * What a node is, as far as a NodeVisitor is concerned.
+	 */
+	enum Kind {
+		TOKEN,		// T<> and C<>
+		SEQUENCE,	// S<>
+		REPETITION,	// ZeroOrMore<>
+		OPTION,		// ZeroOrOne<>
+		CHOICE,		// OneOf<>
+		EXPRESSION	// An operator and its operands in an Expr<>
+	};
+
+	virtual void accept(NodeVisitor& visitor) const = 0;
+
+	// Write the tree in the same form as asString(), but straight
+	// to 'out'.
+	//
+	void write(Writer& out, int indent = 0) const;
+
+	std::string asString(int indent = 0) const;
+};
+
+/**
+ * Walks a tree of Nodes.  Token nodes are passed to token(); every
+ * other node gets a call to enter(), then its children in order, then
+ * leave().  If enter() returns false the children are skipped, but
+ * leave() is still called.
+ */
+class NodeVisitor
+{
+public:
+	virtual
+	~NodeVisitor()
+	{}
+
+	virtual void token(const Node& node, const Token& token) = 0;
+
+	virtual bool
+	enter(const Node& node, Node::Kind kind, std::size_t children)
+	{
+		return true;
+	}
+
+	virtual void
+	leave(const Node& node, Node::Kind kind, std::size_t children)
+	{}
+};
+
+template <int CATEGORY_FILTER>
+class C : public Node
+{
+public:
+	C(token_iterator token_) : token(token_)
+	{}
 	
-	virtual std::string asString(int indent = 0) const = 0;
+	token_iterator token;
+
+	void
+	accept(NodeVisitor& visitor) const
+	{
+		visitor.token(*this, *token);
+	}
+
 	
-	static std::string 
-	indentString(int i)
+	static std::string
+	ruleString(int indent = 0)
+	{
+		return std::string("<") + categoryString(CATEGORY_FILTER) + ">";
+	}
+
+	static void
+	first(FirstSet& set)
+	{
+		for (int id = INVALID; id < FINAL_SENTINAL; id ++) {
+			if (category(TokenId(id)) & CATEGORY_FILTER) {
+				set.set(id);
+			}
+		}
+	}
+
+	static bool
+	nullable()
+	{
+		return false;
+	}
+
+	static bool
+	match (token_iterator &begin, const token_iterator &end, MatchState& state)
+	{
+		if (begin == end || !(begin->category() & CATEGORY_FILTER)) {
+			state.fail(begin);
+			return false;
+		}
+		begin ++;
+		return true;
+	}
+
+	static uint32_t
+	build (token_iterator &begin, const token_iterator &end, FlatTree& tree)
+	{
+		if (begin == end || !(begin->category() & CATEGORY_FILTER)) {
+			return FlatTree::NONE;
+		}
+		uint32_t ret = tree.leaf(FlatTree::kind<C>(), begin.index());
+		begin ++;
+		return ret;
+	}
+
+	typedef token_iterator Value;
+
+	static bool
+	parseValue (token_iterator &begin, const token_iterator &end, Value& value)
+	{
+		if (begin == end || !(begin->category() & CATEGORY_FILTER)) {
+			return false;
+		}
+		value = begin;
+		begin ++;
+		return true;
+	}
+
+	static C *
+	parse (token_iterator &begin, const token_iterator &end, ParseContext& context)
+	{
+		PGPARSE_PROFILE_START(C, begin);
+		if (begin == end || !(begin->category() & CATEGORY_FILTER)) {
+			PGPARSE_PROFILE_FINISH(false, begin);
+			return 0;
+		}
+		C *ret = new (context) C(begin);
+		begin ++;
+		PGPARSE_PROFILE_FINISH(true, begin);
+		return ret;
+	}
+
+	static void
+	resume(ResumableParse& parse, ResumableParse::Frame& frame)
 	{
-		std::string tabs;
-		while (i) {
-			tabs += "\t";
-			i --;
+		if (!parse.ready()) {
+			return;
+		}
+		const Token *token = parse.token();
+		if (!token || !(token->category() & CATEGORY_FILTER)) {
+			parse.expected();
+			parse.fail();
+			return;
 		}
-		return tabs;
+		C *ret = new (parse.context()) C(parse.iterator(parse.position()));
+		parse.advance();
+		parse.succeed(ret);
+	}
+};
+
+template <PGParse::TokenId ID>
+class T : public Node
+{
+public:
+	T(token_iterator token_) : token(token_)
+	{}
+	
+	void
+	accept(NodeVisitor& visitor) const
+	{
+		visitor.token(*this, *token);
 	}
+	
+	token_iterator token;
+	
+	static std::string
+	ruleString(int indent = 0)
+	{
+		return std::string("<") + idString(ID) + ">";
+	}
+
+	static void
+	first(FirstSet& set)
+	{
+		set.set(ID);
+	}
+
+	static bool
+	nullable()
+	{
+		return false;
+	}
+
+	static bool
+	match (token_iterator &begin, const token_iterator &end, MatchState& state)
+	{
+		if (begin == end || begin->id() != ID) {
+			state.fail(begin);
+			return false;
+		}
+		begin ++;
+		return true;
+	}
+
+	static uint32_t
+	build (token_iterator &begin, const token_iterator &end, FlatTree& tree)
+	{
+		if (begin == end || begin->id() != ID) {
+			return FlatTree::NONE;
+		}
+		uint32_t ret = tree.leaf(FlatTree::kind<T>(), begin.index());
+		begin ++;
+		return ret;
+	}
+
+	typedef token_iterator Value;
+
+	static bool
+	parseValue (token_iterator &begin, const token_iterator &end, Value& value)
+	{
+		if (begin == end || begin->id() != ID) {
+			return false;
+		}
+		value = begin;
+		begin ++;
+		return true;
+	}
+
+	static T *
+	parse (token_iterator &begin, const token_iterator &end, ParseContext& context)
+	{
+		PGPARSE_PROFILE_START(T, begin);
+		if (begin == end || begin->id() != ID) {
+			PGPARSE_PROFILE_FINISH(false, begin);
+			return 0;
+		}
+		T *ret = new (context) T(begin);
+		begin ++;
+		PGPARSE_PROFILE_FINISH(true, begin);
+		return ret;
+	}
+
+	static void
+	resume(ResumableParse& parse, ResumableParse::Frame& frame)
+	{
+		if (!parse.ready()) {
+			return;
+		}
+		const Token *token = parse.token();
+		if (!token || token->id() != ID) {
+			parse.expected();
+			parse.fail();
+			return;
+		}
+		T *ret = new (parse.context()) T(parse.iterator(parse.position()));
+		parse.advance();
+		parse.succeed(ret);
+	}
+};
+
+/**
+ * Left-factoring for the alternatives of a OneOf.
+ *
+ * Alternatives that are sequences remember each element they parse, and
+ * an alternative whose leading element types match the one before it
+ * reuses those elements instead of parsing them again.  Since all
+ * alternatives start at the same token, the same leading rules always
+ * give the same results.  The nodes built are exactly those of an
+ * unfactored parse.
+ *
+ * The elements' nodes are in the arena one after the other, and
+ * nothing else is left after them, so an alternative that parses an
+ * element afresh first gives back the nodes of the elements it
+ * replaces, and one that fails gives back anything past the prefix.
+ */
+struct SharedPrefix
+{
+	static const int MAX_DEPTH = 8;
+
+	struct Element
+	{
+		const void *rule;
+		Node *node;
+		token_iterator end;
+		Arena::Mark before;
+	};
+
+	int depth;
+	Element elements[MAX_DEPTH];
+
+	// The end of the last element's nodes.
+	//
+	Arena::Mark after;
+
+	explicit
+	SharedPrefix(const Arena::Mark& start) : depth(0), after(start)
+	{}
+};
+
+/**
+ * The elements of a sequence, from the I'th on.  This is where the
+ * work of S is done, one element at a time; the children are stored
+ * in an array in the S node itself.
+ */
+template <std::size_t I, class... RULES>
+struct Elements
+{
+	static std::string
+	ruleString(int indent = 0)
+	{
+		return std::string("");
+	}
+
+	static void
+	first(FirstSet& set)
+	{}
+
+	static bool
+	nullable()
+	{
+		return true;
+	}
+
+	static bool
+	parse (Node **children, token_iterator &begin, const token_iterator &end, ParseContext& context)
+	{
+		return true;
+	}
+
+	static bool
+	match (token_iterator &begin, const token_iterator &end, MatchState& state)
+	{
+		return true;
+	}
+
+	static bool
+	build (
+		token_iterator &begin, 
+		const token_iterator &end, 
+		FlatTree& tree, 
+		uint32_t parent, 
+		uint32_t& last
+	)
+	{
+		return true;
+	}
+
+	template <class TUPLE>
+	static bool
+	parseValue (token_iterator &begin, const token_iterator &end, TUPLE& value)
+	{
+		return true;
+	}
+
+	static bool
+	parsePrefixed (
+		Node **children, 
+		token_iterator &begin, 
+		const token_iterator &end, 
+		ParseContext& context, 
+		SharedPrefix& prefix
+	)
+	{
+		return true;
+	}
+};
+
+template <std::size_t I, class RULE, class... REST>
+struct Elements<I, RULE, REST...>
+{
+	typedef Elements<I + 1, REST...> Rest;
+
+	static std::string
+	ruleString(int indent = 0)
+	{
+		return RULE::ruleString(indent) + " " + Rest::ruleString(indent);
+	}
+
+	static void
+	first(FirstSet& set)
+	{
+		RULE::first(set);
+		if (RULE::nullable()) {
+			Rest::first(set);
+		}
+	}
+
+	static bool
+	nullable()
+	{
+		return RULE::nullable() && Rest::nullable();
+	}
+
+	static bool
+	parse (Node **children, token_iterator &begin, const token_iterator &end, ParseContext& context)
+	{
+		children[I] = RULE::parse(begin, end, context);
+		return children[I] && Rest::parse(children, begin, end, context);
+	}
+
+	static bool
+	match (token_iterator &begin, const token_iterator &end, MatchState& state)
+	{
+		return RULE::match(begin, end, state) && Rest::match(begin, end, state);
+	}
+
+	static bool
+	build (
+		token_iterator &begin, 
+		const token_iterator &end, 
+		FlatTree& tree, 
+		uint32_t parent, 
+		uint32_t& last
+	)
+	{
+		uint32_t child = RULE::build(begin, end, tree);
+		if (child == FlatTree::NONE) {
+			return false;
+		}
+		if (child != FlatTree::EMPTY) {
+			tree.link(parent, last, child);
+			last = child;
+		}
+		return Rest::build(begin, end, tree, parent, last);
+	}
+
+	template <class TUPLE>
+	static bool
+	parseValue (token_iterator &begin, const token_iterator &end, TUPLE& value)
+	{
+		return RULE::parseValue(begin, end, std::get<I>(value))
+			&& Rest::parseValue(begin, end, value);
+	}
+
+	static bool
+	parsePrefixed (
+		Node **children, 
+		token_iterator &begin, 
+		const token_iterator &end, 
+		ParseContext& context, 
+		SharedPrefix& prefix
+	)
+	{
+		const int level = I;
+		if (level < prefix.depth && prefix.elements[level].rule == ruleKey<RULE>()) {
+			children[I] = prefix.elements[level].node;
+			if (children[I]) {
+				begin = prefix.elements[level].end;
+			}
+		} else {
+			if (level < prefix.depth) {
+				context.rewind(prefix.elements[level].before);
+			}
+			Arena::Mark before = context.arena.mark();
+			children[I] = RULE::parse(begin, end, context);
+			if (level < SharedPrefix::MAX_DEPTH) {
+				SharedPrefix::Element element = { ruleKey<RULE>(), children[I], begin, before };
+				prefix.elements[level] = element;
+				prefix.depth = level + 1;
+				prefix.after = context.arena.mark();
+			} else {
+				prefix.depth = SharedPrefix::MAX_DEPTH;
+			}
+		}
+		return children[I] && Rest::parsePrefixed(children, begin, end, context, prefix);
+	}
+};
+
+/**
+ * A sequence of rules, all of which must match.
+ *
+ * The node holds its children in a single array, so a sequence of any
+ * length is one allocation.
+ */
+template <class... ELEMENTS>
+class S : public Node
+{
+public:
+	static const std::size_t SIZE = sizeof...(ELEMENTS);
+
+private:
+	typedef Elements<0, ELEMENTS...> Children;
+
+	Node *children_[SIZE ? SIZE : 1];
+	
+	S()
+	{}
+
+public:
+	std::size_t
+	size() const
+	{
+		return SIZE;
+	}
+
+	Node *
+	child(std::size_t i) const
+	{
+		return children_[i];
+	}
+
+	void
+	accept(NodeVisitor& visitor) const
+	{
+		if (visitor.enter(*this, SEQUENCE, SIZE)) {
+			for (std::size_t i = 0; i < SIZE; i ++) {
+				children_[i]->accept(visitor);
+			}
+		}
+		visitor.leave(*this, SEQUENCE, SIZE);
+	}
+	
+	static std::string
+	ruleString(int indent = 0)
+	{
+		return Children::ruleString(indent);
+	}
+
+	static void
+	first(FirstSet& set)
+	{
+		Children::first(set);
+	}
+
+	static bool
+	nullable()
+	{
+		return Children::nullable();
+	}
+	
+	// Every rule leaves 'begin' where it was if it fails, so the
+	// alternatives of a OneOf all start from the same token.
+	//
+	static S *
+	parseSequence (token_iterator &begin, const token_iterator &end, ParseContext& context)
+	{
+		PGPARSE_PROFILE_START(S, begin);
+		token_iterator start = begin;
+		Arena::Mark mark = context.arena.mark();
+		S *ret = new (context) S();
+		if (!Children::parse(ret->children_, begin, end, context)) {
+			PGPARSE_PROFILE_BACKTRACK(begin);
+			context.rewind(mark);
+			begin = start;
+			PGPARSE_PROFILE_FINISH(false, begin);
+			return 0;
+		}
+		PGPARSE_PROFILE_FINISH(true, begin);
+		return ret;
+	}
+
+	static S *
+	parse (token_iterator &begin, const token_iterator &end, ParseContext& context)
+	{
+		return context.parse<S>(begin, end, &S::parseSequence);
+	}
+
+	static bool
+	match (token_iterator &begin, const token_iterator &end, MatchState& state)
+	{
+		token_iterator start = begin;
+		if (!Children::match(begin, end, state)) {
+			begin = start;
+			return false;
+		}
+		return true;
+	}
+
+	typedef std::tuple<typename ELEMENTS::Value...> Value;
+
+	static bool
+	parseValue (token_iterator &begin, const token_iterator &end, Value& value)
+	{
+		token_iterator start = begin;
+		if (!Children::parseValue(begin, end, value)) {
+			begin = start;
+			return false;
+		}
+		return true;
+	}
+
+	static uint32_t
+	build (token_iterator &begin, const token_iterator &end, FlatTree& tree)
+	{
+		token_iterator start = begin;
+		uint32_t ret = tree.open(FlatTree::kind<S>(), begin.index());
+		uint32_t last = FlatTree::NONE;
+		if (!Children::build(begin, end, tree, ret, last)) {
+			tree.truncate(ret);
+			begin = start;
+			return FlatTree::NONE;
+		}
+		tree.close(ret, last);
+		return ret;
+	}
+
+	// Like parseSequence, but reusing the elements that an earlier
+	// alternative of the same OneOf started with.  A failure only
+	// gives back what's past the prefix, since later alternatives may
+	// still want the elements; the OneOf rewinds once it's done with
+	// all of them.  The node itself is allocated last, so that it
+	// never sits between the elements.
+	//
+	static S *
+	parsePrefixed (
+		token_iterator &begin, 
+		const token_iterator &end, 
+		ParseContext& context, 
+		SharedPrefix& prefix
+	)
+	{
+		PGPARSE_PROFILE_START(S, begin);
+		token_iterator start = begin;
+		Node *children[SIZE ? SIZE : 1];
+		if (!Children::parsePrefixed(children, begin, end, context, prefix)) {
+			PGPARSE_PROFILE_BACKTRACK(begin);
+			context.rewind(prefix.after);
+			begin = start;
+			PGPARSE_PROFILE_FINISH(false, begin);
+			return 0;
+		}
+		S *ret = new (context) S();
+		for (std::size_t i = 0; i < SIZE; i ++) {
+			ret->children_[i] = children[i];
+		}
+		PGPARSE_PROFILE_FINISH(true, begin);
+		return ret;
+	}
+
+	// The node is allocated first and filled in as each element
+	// ends, as parseSequence does; frame.index is the element in
+	// progress.  An alternative of a OneOf isn't memoized, as with
+	// parsePrefixed: the OneOf is.
+	//
+	static void
+	resumeSequence(ResumableParse& parse, ResumableParse::Frame& frame, bool memoized)
+	{
+		static const ResumableParse::Resume elements[] = { &ELEMENTS::resume..., 0 };
+		S *node = static_cast<S *>(frame.node);
+		if (!node) {
+			if (memoized && parse.recall(frame, ruleKey<S>())) {
+				return;
+			}
+			node = new (parse.context()) S();
+			frame.node = node;
+		} else if (parse.result()) {
+			node->children_[frame.index ++] = parse.result();
+		} else {
+			parse.fail();
+			return;
+		}
+		if (frame.index == SIZE) {
+			parse.succeed(node);
+			return;
+		}
+		parse.call(elements[frame.index]);
+	}
+
+	static void
+	resume(ResumableParse& parse, ResumableParse::Frame& frame)
+	{
+		resumeSequence(parse, frame, true);
+	}
+
+	static void
+	resumeAlternative(ResumableParse& parse, ResumableParse::Frame& frame)
+	{
+		resumeSequence(parse, frame, false);
+	}
+};
+
+/**
+ * How a OneOf parses one of its alternatives: sequences go through
+ * S::parsePrefixed, and everything else is parsed as usual.  resume()
+ * is the same for a ResumableParse.
+ */
+template <class RULE>
+struct Alternative
+{
+	static Node *
+	parse (token_iterator &begin, const token_iterator &end, ParseContext& context, SharedPrefix& prefix)
+	{
+		return RULE::parse(begin, end, context);
+	}
+
+	static void
+	resume(ResumableParse& parse, ResumableParse::Frame& frame)
+	{
+		RULE::resume(parse, frame);
+	}
+};
+
+template <class... ELEMENTS>
+struct Alternative< S<ELEMENTS...> >
+{
+	static Node *
+	parse (token_iterator &begin, const token_iterator &end, ParseContext& context, SharedPrefix& prefix)
+	{
+		return S<ELEMENTS...>::parsePrefixed(begin, end, context, prefix);
+	}
+
+	static void
+	resume(ResumableParse& parse, ResumableParse::Frame& frame)
+	{
+		S<ELEMENTS...>::resumeAlternative(parse, frame);
+	}
+};
+
+template <class NODE>
+class ZeroOrMore : public Node
+{
+private:
+	// An arena-allocated list, since std::list would need
+	// a destructor to free its cells.
+	//
+	struct Item
+	{
+		NODE *node;
+		Item *next;
+	};
+
+	Item *first_;
+	Item *last_;
+	std::size_t count_;
+	
+	ZeroOrMore() : first_(0), last_(0), count_(0)
+	{}
+
+public:
+	void
+	append(NODE* node, ParseContext& context)
+	{
+		Item *item = new (context.arena.allocate(sizeof(Item))) Item();
+		item->node = node;
+		item->next = 0;
+		if (last_) {
+			last_->next = item;
+		} else {
+			first_ = item;
+		}
+		last_ = item;
+		count_ ++;
+	}
+
+	std::size_t
+	size() const
+	{
+		return count_;
+	}
+	
+	void
+	accept(NodeVisitor& visitor) const
+	{
+		if (visitor.enter(*this, REPETITION, count_)) {
+			for (const Item *i = first_; i; i = i->next) {
+				i->node->accept(visitor);
+			}
+		}
+		visitor.leave(*this, REPETITION, count_);
+	}
+
+	static std::string
+	ruleString(int indent = 0)
+	{
+		return std::string(" { ") + NODE::ruleString(indent) + " }* ";
+	}
+
+	static void
+	first(FirstSet& set)
+	{
+		NODE::first(set);
+	}
+
+	static bool
+	nullable()
+	{
+		return true;
+	}
+	
+	static bool
+	match (token_iterator &begin, const token_iterator &end, MatchState& state)
+	{
+		while (NODE::match(begin, end, state))
+		{}
+		return true;
+	}
+
+	typedef std::vector<typename NODE::Value> Value;
+
+	static bool
+	parseValue (token_iterator &begin, const token_iterator &end, Value& value)
+	{
+		value.clear();
+		typename NODE::Value item;
+		while (NODE::parseValue(begin, end, item)) {
+			value.push_back(std::move(item));
+		}
+		return true;
+	}
+
+	static uint32_t
+	build (token_iterator &begin, const token_iterator &end, FlatTree& tree)
+	{
+		uint32_t ret = tree.open(FlatTree::kind<ZeroOrMore>(), begin.index());
+		uint32_t last = FlatTree::NONE;
+		uint32_t child;
+		while ((child = NODE::build(begin, end, tree)) != FlatTree::NONE && child != FlatTree::EMPTY) {
+			tree.link(ret, last, child);
+			last = child;
+		}
+		if (last == FlatTree::NONE) {
+			tree.truncate(ret);
+			return FlatTree::EMPTY;
+		}
+		tree.close(ret, last);
+		return ret;
+	}
+
+	static ZeroOrMore *
+	parse (token_iterator &begin, const token_iterator &end, ParseContext& context)
+	{
+		PGPARSE_PROFILE_START(ZeroOrMore, begin);
+		ZeroOrMore *ret = new (context) ZeroOrMore();
+		NODE *result = 0;
+		while ((result = NODE::parse(begin, end, context))) {
+			ret->append(result, context);
+		}
+		PGPARSE_PROFILE_FINISH(true, begin);
+		return ret;
+	}
+
+	static void
+	resume(ResumableParse& parse, ResumableParse::Frame& frame)
+	{
+		ZeroOrMore *node = static_cast<ZeroOrMore *>(frame.node);
+		if (!node) {
+			frame.node = new (parse.context()) ZeroOrMore();
+		} else if (parse.result()) {
+			node->append(static_cast<NODE *>(parse.result()), parse.context());
+		} else {
+			parse.succeed(node);
+			return;
+		}
+		parse.call(&NODE::resume);
+	}
+};
+
+template <class NODE>
+class ZeroOrOne : public Node
+{
+private:
+	NODE* node_;
+	
+	ZeroOrOne(NODE *node) : node_(node)
+	{}
+
+public:
+	void
+	accept(NodeVisitor& visitor) const
+	{
+		if (visitor.enter(*this, OPTION, node_ ? 1 : 0) && node_) {
+			node_->accept(visitor);
+		}
+		visitor.leave(*this, OPTION, node_ ? 1 : 0);
+	}
+
+	static std::string
+	ruleString(int indent = 0)
+	{
+		return std::string(" [ ") + NODE::ruleString(indent) + " ]? ";
+	}
+
+	static void
+	first(FirstSet& set)
+	{
+		NODE::first(set);
+	}
+
+	static bool
+	nullable()
+	{
+		return true;
+	}
+	
+	static bool
+	match (token_iterator &begin, const token_iterator &end, MatchState& state)
+	{
+		NODE::match(begin, end, state);
+		return true;
+	}
+
+	typedef boost::optional<typename NODE::Value> Value;
+
+	static bool
+	parseValue (token_iterator &begin, const token_iterator &end, Value& value)
+	{
+		typename NODE::Value item;
+		if (NODE::parseValue(begin, end, item)) {
+			value = std::move(item);
+		} else {
+			value = boost::none;
+		}
+		return true;
+	}
+
+	static uint32_t
+	build (token_iterator &begin, const token_iterator &end, FlatTree& tree)
+	{
+		uint32_t ret = tree.open(FlatTree::kind<ZeroOrOne>(), begin.index());
+		uint32_t child = NODE::build(begin, end, tree);
+		if (child == FlatTree::NONE || child == FlatTree::EMPTY) {
+			tree.truncate(ret);
+			return FlatTree::EMPTY;
+		}
+		tree.link(ret, FlatTree::NONE, child);
+		tree.close(ret, child);
+		return ret;
+	}
+
+	static ZeroOrOne *
+	parse (token_iterator &begin, const token_iterator &end, ParseContext& context)
+	{
+		PGPARSE_PROFILE_START(ZeroOrOne, begin);
+		NODE *node = NODE::parse(begin, end, context);
+		PGPARSE_PROFILE_FINISH(true, begin);
+		return new (context) ZeroOrOne(node);
+	}
+
+	static void
+	resume(ResumableParse& parse, ResumableParse::Frame& frame)
+	{
+		if (!frame.state) {
+			frame.state = 1;
+			parse.call(&NODE::resume);
+			return;
+		}
+		parse.succeed(new (parse.context()) ZeroOrOne(static_cast<NODE *>(parse.result())));
+	}
+};
+
+/**
+ * Which of N alternatives can start with each token id, as bit masks
+ * with bit i standing for the i'th alternative.  Alternatives that can
+ * match nothing are always candidates.
+ *
+ * The FIRST sets come from the rule types, but C<> rules depend on
+ * the category table, so each table is filled in on first use.
+ */
+template <std::size_t N>
+struct OneOfDispatch
+{
+	typedef Node *(*Parser)(token_iterator &, const token_iterator &, ParseContext &, SharedPrefix &);
+	typedef bool (*Matcher)(token_iterator &, const token_iterator &, MatchState &);
+	typedef uint32_t (*Builder)(token_iterator &, const token_iterator &, FlatTree &);
+
+	static const std::size_t WORDS = N ? (N + 63) / 64 : 1;
+
+	typedef Node *(*Predictor)(token_iterator &, const token_iterator &, ParseContext &);
+
+	static const uint32_t NO_ALTERNATIVE = ~uint32_t(0);
+	static const uint32_t CONFLICT = NO_ALTERNATIVE - 1;
+
+	uint64_t candidates[FINAL_SENTINAL][WORDS];
+	uint64_t nullable[WORDS];
+	Parser parsers[N ? N : 1];
+	Predictor predictors[N ? N : 1];
+	Matcher matchers[N ? N : 1];
+	Builder builders[N ? N : 1];
+	ResumableParse::Resume resumes[N ? N : 1];
+
+	// The LL(1) parse table: for each token id, the only alternative
+	// that can start with it, NO_ALTERNATIVE, or CONFLICT if there's
+	// more than one.  'predict_end' is the same for the end of input.
+	//
+	uint32_t predict[FINAL_SENTINAL];
+	uint32_t predict_end;
+
+	// The single alternative in 'mask' and 'nullable' together.
+	//
+	uint32_t
+	predictFrom(const uint64_t *mask) const
+	{
+		uint32_t found = NO_ALTERNATIVE;
+		for (std::size_t word = 0; word < WORDS; word ++) {
+			uint64_t bits = nullable[word] | (mask ? mask[word] : 0);
+			if (!bits) {
+				continue;
+			}
+			if (found != NO_ALTERNATIVE || (bits & (bits - 1))) {
+				return CONFLICT;
+			}
+			found = word * 64 + __builtin_ctzll(bits);
+		}
+		return found;
+	}
+
+	void
+	fillPredictions()
+	{
+		for (int id = 0; id < FINAL_SENTINAL; id ++) {
+			predict[id] = predictFrom(candidates[id]);
+		}
+		predict_end = predictFrom(0);
+	}
+};
+
+/**
+ * The alternatives of a OneOf, from the I'th on.
+ */
+template <std::size_t I, class... RULES>
+struct Choices
+{
+	static std::string
+	ruleString(int indent = 0)
+	{
+		return std::string("");
+	}
+
+	static void
+	first(FirstSet& set)
+	{}
+
+	static bool
+	nullable()
+	{
+		return false;
+	}
+
+	template <class DISPATCH>
+	static void
+	addAlternatives(DISPATCH& dispatch)
+	{}
+
+	template <class VARIANT>
+	static bool
+	parseValue (
+		token_iterator &begin, 
+		const token_iterator &end, 
+		const uint64_t *candidates, 
+		VARIANT& value
+	)
+	{
+		return false;
+	}
+};
+
+/**
+ * The Value type of a OneOf: a variant of the alternatives' values,
+ * each wrapped in an Alt with its index.  ALTS collects the wrapped
+ * types as the list of RULES is worked through.
+ */
+template <class... TYPES>
+struct TypeList
+{};
+
+template <std::size_t I, class ALTS, class... RULES>
+struct ChoiceValue;
+
+template <std::size_t I>
+struct ChoiceValue< I, TypeList<> >
+{
+	typedef boost::blank type;
+};
+
+template <std::size_t I, class... ALTS>
+struct ChoiceValue< I, TypeList<ALTS...> >
+{
+	typedef boost::variant<ALTS...> type;
 };
 
-template <int CATEGORY_FILTER>
-class C : public Node
+template <std::size_t I, class... ALTS, class RULE, class... REST>
+struct ChoiceValue< I, TypeList<ALTS...>, RULE, REST... >
 {
-public:
-	C(token_iterator token_) : token(token_)
-	{}
-	
-	~C()
-	{}
-	
-	token_iterator token;
+	typedef typename ChoiceValue<
+		I + 1, 
+		TypeList< ALTS..., Alt<I, typename RULE::Value> >, 
+		REST...
+	>::type type;
+};
+
+template <std::size_t I, class RULE, class... REST>
+struct Choices<I, RULE, REST...>
+{
+	typedef Choices<I + 1, REST...> Rest;
 
-	std::string
-	asString(int indent = 0) const
+	static Node *
+	parse (token_iterator &begin, const token_iterator &end, ParseContext& context, SharedPrefix& prefix)
 	{
-		std::string ret("<");
-		const char *s = token->idString();
-		while (*s) {
-			ret +=toupper(*s);
-			s ++;
-		}
-		ret += '>';
-		return ret;
+		return Alternative<RULE>::parse(begin, end, context, prefix);
+	}
+
+	static Node *
+	predicted (token_iterator &begin, const token_iterator &end, ParseContext& context)
+	{
+		return RULE::parse(begin, end, context);
 	}
 
-	
 	static std::string
 	ruleString(int indent = 0)
 	{
-		return std::string("<") + categoryString(CATEGORY_FILTER) + ">";
+		return RULE::ruleString(indent) 
+			+ (sizeof...(REST) ? " | " : "") 
+			+ Rest::ruleString(indent);
 	}
 
-	static C *
-	parse (token_iterator &begin, const token_iterator &end)
+	static void
+	first(FirstSet& set)
 	{
-		if (begin == end || !(begin->category() & CATEGORY_FILTER)) {
-			return 0;
-		}
-		C *ret = new C(begin);
-		begin ++;
-		return ret;
+		RULE::first(set);
+		Rest::first(set);
 	}
-};
 
-template <PGParse::TokenId ID>
-class T : public Node
-{
-public:
-	T(token_iterator token_) : token(token_)
-	{}
-	
-	~T()
-	{}
-	
-	std::string
-	asString(int indent = 0) const
+	static bool
+	nullable()
 	{
-		std::string ret("<");
-		const char *s = token->idString();
-		while (*s) {
-			ret +=toupper(*s);
-			s ++;
-		}
-		ret += '>';
-		return ret;
+		return RULE::nullable() || Rest::nullable();
 	}
-	
-	token_iterator token;
-	
-	static std::string
-	ruleString(int indent = 0)
+
+	template <class DISPATCH>
+	static void
+	addAlternatives(DISPATCH& dispatch)
 	{
-		return std::string("<") + idString(ID) + ">";
+		const uint64_t bit = uint64_t(1) << (I % 64);
+		FirstSet set;
+		RULE::first(set);
+		for (int id = 0; id < FINAL_SENTINAL; id ++) {
+			if (set.test(id)) {
+				dispatch.candidates[id][I / 64] |= bit;
+			}
+		}
+		if (RULE::nullable()) {
+			dispatch.nullable[I / 64] |= bit;
+		}
+		dispatch.parsers[I] = &parse;
+		dispatch.predictors[I] = &predicted;
+		dispatch.matchers[I] = &RULE::match;
+		dispatch.builders[I] = &RULE::build;
+		dispatch.resumes[I] = &Alternative<RULE>::resume;
+		Rest::addAlternatives(dispatch);
 	}
 
-	static T *
-	parse (token_iterator &begin, const token_iterator &end)
+	// Try the alternatives whose bits are set in 'candidates'.
+	//
+	template <class VARIANT>
+	static bool
+	parseValue (
+		token_iterator &begin, 
+		const token_iterator &end, 
+		const uint64_t *candidates, 
+		VARIANT& value
+	)
 	{
-		if (begin == end || begin->id() != ID) {
-			return 0;
+		if (candidates[I / 64] & (uint64_t(1) << (I % 64))) {
+			Alt<I, typename RULE::Value> alternative;
+			if (RULE::parseValue(begin, end, alternative.value)) {
+				value = std::move(alternative);
+				return true;
+			}
 		}
-		T *ret = new T(begin);
-		begin ++;
-		return ret;
+		return Rest::parseValue(begin, end, candidates, value);
 	}
 };
 
-using namespace Loki;
-
-template <
-	class T01=NullType,class T02=NullType,class T03=NullType,class T04=NullType,class T05=NullType,
-	class T06=NullType,class T07=NullType,class T08=NullType,class T09=NullType,class T10=NullType,
-	class T11=NullType,class T12=NullType,class T13=NullType,class T14=NullType,class T15=NullType,
-	class T16=NullType,class T17=NullType,class T18=NullType,class T19=NullType,class T20=NullType
->
-class S : public Node
+/**
+ * An ordered choice: the first alternative that matches wins.
+ */
+template <class... ALTERNATIVES>
+class OneOf : public Node
 {
 public:
-	typedef T01 Head;
-	typedef S<T02,T03,T04,T05,T06,T07,T08,T09,T10,
-	             T11,T12,T13,T14,T15,T16,T17,T18,T19,T20> TailNode;
+	static const std::size_t SIZE = sizeof...(ALTERNATIVES);
 
 private:
-	Node *head_;
-	Node *tail_;
+	typedef Choices<0, ALTERNATIVES...> Alternatives;
+	typedef OneOfDispatch<SIZE> Dispatch;
+
+	Node *node_;
+	std::size_t index_;
 	
-	S(Node *head = 0, Node *tail = 0) : head_(head), tail_(tail)
+	OneOf(Node *node, std::size_t index) : node_(node), index_(index)
 	{}
 
-public:
-	~S()
+	static Dispatch
+	buildDispatch()
 	{
-		delete head_;
-		delete tail_;
+		Dispatch dispatch;
+		std::memset(&dispatch, 0, sizeof(dispatch));
+		Alternatives::addAlternatives(dispatch);
+		dispatch.fillPredictions();
+		return dispatch;
 	}
-	
-	std::string
-	asString(int indent = 0) const
+
+	static const Dispatch&
+	getDispatch()
 	{
-		return 
-			std::string("") 
-			+ head_->asString() 
-			+ " " 
-			+ tail_->asString();
+		static const Dispatch dispatch = buildDispatch();
+		return dispatch;
 	}
-	
-	static std::string
-	ruleString(int indent = 0)
+
+	// The first alternative from 'from' on that can start with 'token'
+	// (0 for the end of the input), or SIZE if there's none.
+	//
+	static std::size_t
+	nextCandidate(const Token *token, std::size_t from)
 	{
-		return Head::ruleString(indent) + " " + TailNode::ruleString(indent);
-	}
-	
-	static S *
-	parse (token_iterator &begin, const token_iterator &end)
-	{
-		S *result = 0;
-		Node *head = Head::parse(begin, end);
-		Node *tail = 0;
-		if (head) {
-			tail = TailNode::parse(begin, end);
-			if (!tail) {
-				delete head;
-			} else {
-				result = new S(head, tail);
+		const Dispatch& dispatch = getDispatch();
+		for (std::size_t word = from / 64; word < Dispatch::WORDS; word ++) {
+			uint64_t candidates = dispatch.nullable[word];
+			if (token) {
+				candidates |= dispatch.candidates[token->id()][word];
+			}
+			if (word == from / 64) {
+				candidates &= ~uint64_t(0) << (from % 64);
+			}
+			if (candidates) {
+				return word * 64 + __builtin_ctzll(candidates);
 			}
 		}
-		return result;
+		return SIZE;
 	}
-};
 
-template <>
-class S< NullType > : public Node
-{
 public:
-	~S()
-	{}
-	
-	std::string
-	asString(int indent = 0) const
+	// The node of the alternative that matched.
+	//
+	Node *
+	node() const
 	{
-		return std::string("");
+		return node_;
+	}
+
+	// Which alternative matched, counting from zero.
+	//
+	std::size_t
+	index() const
+	{
+		return index_;
 	}
 
+	void
+	accept(NodeVisitor& visitor) const
+	{
+		if (visitor.enter(*this, CHOICE, 1)) {
+			node_->accept(visitor);
+		}
+		visitor.leave(*this, CHOICE, 1);
+	}
+	
 	static std::string
 	ruleString(int indent = 0)
 	{
-		return std::string("");
+		return std::string(" [ ")
+			+ Alternatives::ruleString(indent) 
+			+ " ] ";
 	}
 	
-	static S *
-	parse (token_iterator &begin, const token_iterator &end)
+	static void
+	first(FirstSet& set)
 	{
-		return new S();
+		Alternatives::first(set);
 	}
-};
 
-template <class NODE>
-class ZeroOrMore : public Node
-{
-private:
-	std::list<NODE*> nodes_;
-	
-	ZeroOrMore() : nodes_()
-	{}
+	static bool
+	nullable()
+	{
+		return Alternatives::nullable();
+	}
 
-public:
-	~ZeroOrMore()
+	/**
+	 * Whether the choice is LL(1): no token (or the end of input) can
+	 * start more than one alternative, counting the nullable ones as
+	 * able to start anywhere.
+	 */
+	static bool
+	ll1()
 	{
-		while (nodes_.size()) {
-			delete nodes_.front();
-			nodes_.pop_front();
+		const Dispatch& dispatch = getDispatch();
+		for (int id = 0; id < FINAL_SENTINAL; id ++) {
+			if (dispatch.predict[id] == Dispatch::CONFLICT) {
+				return false;
+			}
 		}
+		return dispatch.predict_end != Dispatch::CONFLICT;
 	}
-	
-	void
-	append(NODE* node)
+
+	/**
+	 * Try only the alternatives that can start with the current token,
+	 * in their original order.  Where the parse table predicts a single
+	 * alternative that's all there is to it: one lookup, one attempt,
+	 * and nothing kept for backtracking.  Only tokens that start more
+	 * than one alternative fall back to trying them in turn.
+	 */
+	static OneOf *
+	parseChoice (token_iterator &begin, const token_iterator &end, ParseContext& context)
+	{
+		PGPARSE_PROFILE_START(OneOf, begin);
+		const Dispatch& dispatch = getDispatch();
+		uint32_t predicted = begin == end ? dispatch.predict_end : dispatch.predict[begin->id()];
+		if (predicted != Dispatch::CONFLICT) {
+			Node *node = predicted == Dispatch::NO_ALTERNATIVE
+				? 0
+				: dispatch.predictors[predicted](begin, end, context);
+			PGPARSE_PROFILE_FINISH(node != 0, begin);
+			return node ? new (context) OneOf(node, predicted) : 0;
+		}
+		Arena::Mark mark = context.arena.mark();
+		SharedPrefix prefix(mark);
+		std::size_t remaining = 0;
+		uint64_t words[Dispatch::WORDS];
+		for (std::size_t word = 0; word < Dispatch::WORDS; word ++) {
+			words[word] = dispatch.nullable[word];
+			if (begin != end) {
+				words[word] |= dispatch.candidates[begin->id()][word];
+			}
+			remaining += __builtin_popcountll(words[word]);
+		}
+		for (std::size_t word = 0; word < Dispatch::WORDS; word ++) {
+			uint64_t candidates = words[word];
+			while (candidates) {
+				std::size_t index = word * 64 + __builtin_ctzll(candidates);
+				ParseContext::BacktrackPoint point(context, -- remaining > 0);
+				Node *node = dispatch.parsers[index](begin, end, context, prefix);
+				if (node) {
+					PGPARSE_PROFILE_FINISH(true, begin);
+					return new (context) OneOf(node, index);
+				}
+				candidates &= candidates - 1;
+			}
+		}
+		context.rewind(mark);
+		PGPARSE_PROFILE_FINISH(false, begin);
+		return 0;
+	}
+
+	static OneOf *
+	parse (token_iterator &begin, const token_iterator &end, ParseContext& context)
 	{
-		nodes_.push_back(node);
+		return context.parse<OneOf>(begin, end, &OneOf::parseChoice);
 	}
-	
-	std::string
-	asString(int indent = 0) const
+
+	/**
+	 * The same choice as parseChoice makes, a frame at a time.  The
+	 * alternative being tried is frame.index, and the state says how
+	 * it was chosen.  While there are more to try after it, the frame
+	 * holds a backtrack point, so that what it parses is memoized.
+	 */
+	static void
+	resume(ResumableParse& parse, ResumableParse::Frame& frame)
 	{
-		std::string ret;
-		ret += indentString(indent) + " { \n";
-		typename std::list<NODE*>::const_iterator i = nodes_.begin();
-		for ( ; i != nodes_.end(); i++) {
-			ret += indentString(indent) + (*i)->asString(indent +1) + "\n";
+		enum { START, PREDICTED, BACKTRACKING, LAST };
+
+		const Dispatch& dispatch = getDispatch();
+		switch (frame.state) {
+		case START: {
+			if (frame.rule == 0 && parse.recall(frame, ruleKey<OneOf>())) {
+				return;
+			}
+			if (!parse.ready()) {
+				return;
+			}
+			const Token *token = parse.token();
+			uint32_t predicted = token ? dispatch.predict[token->id()] : dispatch.predict_end;
+			if (predicted == Dispatch::NO_ALTERNATIVE) {
+				parse.expected();
+				parse.fail();
+				return;
+			}
+			if (predicted != Dispatch::CONFLICT) {
+				frame.index = predicted;
+				frame.state = PREDICTED;
+				parse.call(dispatch.resumes[predicted]);
+				return;
+			}
+			frame.index = nextCandidate(token, 0);
+			break;
 		}
-		ret += indentString(indent) + " }*\n";
-		return ret;
+		case BACKTRACKING:
+			parse.context().removeBacktrackPoint();
+			// Fall through
+		case PREDICTED:
+		case LAST:
+			if (parse.result()) {
+				parse.succeed(new (parse.context()) OneOf(parse.result(), frame.index));
+				return;
+			}
+			frame.index = frame.state == BACKTRACKING
+				? nextCandidate(parse.token(), frame.index + 1)
+				: SIZE;
+			break;
+		}
+		if (frame.index == SIZE) {
+			// Alternatives that can't start here weren't tried, so
+			// they didn't record the failure themselves.
+			parse.expected();
+			parse.fail();
+			return;
+		}
+		if (nextCandidate(parse.token(), frame.index + 1) < SIZE) {
+			parse.context().addBacktrackPoint();
+			frame.state = BACKTRACKING;
+		} else {
+			frame.state = LAST;
+		}
+		parse.call(dispatch.resumes[frame.index]);
 	}
 
-	static std::string
-	ruleString(int indent = 0)
+	static bool
+	match (token_iterator &begin, const token_iterator &end, MatchState& state)
 	{
-		return std::string(" { ") + NODE::ruleString(indent) + " }* ";
+		const Dispatch& dispatch = getDispatch();
+		for (std::size_t word = 0; word < Dispatch::WORDS; word ++) {
+			uint64_t candidates = dispatch.nullable[word];
+			if (begin != end) {
+				candidates |= dispatch.candidates[begin->id()][word];
+			}
+			while (candidates) {
+				std::size_t index = word * 64 + __builtin_ctzll(candidates);
+				if (dispatch.matchers[index](begin, end, state)) {
+					return true;
+				}
+				candidates &= candidates - 1;
+			}
+		}
+		// Alternatives that can't start here weren't tried, so
+		// they didn't record the failure themselves.
+		state.fail(begin);
+		return false;
 	}
-	
-	static ZeroOrMore *
-	parse (token_iterator &begin, const token_iterator &end)
+
+	typedef typename ChoiceValue< 0, TypeList<>, ALTERNATIVES... >::type Value;
+
+	static bool
+	parseValue (token_iterator &begin, const token_iterator &end, Value& value)
 	{
-		ZeroOrMore *ret = new ZeroOrMore();
-		NODE *result = 0;
-		while (result = NODE::parse(begin, end)) {
-			ret->append(result);
+		const Dispatch& dispatch = getDispatch();
+		uint64_t candidates[Dispatch::WORDS];
+		for (std::size_t word = 0; word < Dispatch::WORDS; word ++) {
+			candidates[word] = dispatch.nullable[word];
+			if (begin != end) {
+				candidates[word] |= dispatch.candidates[begin->id()][word];
+			}
 		}
-		return ret;
+		return Alternatives::parseValue(begin, end, candidates, value);
+	}
+
+	static uint32_t
+	build (token_iterator &begin, const token_iterator &end, FlatTree& tree)
+	{
+		const Dispatch& dispatch = getDispatch();
+		uint32_t ret = tree.open(FlatTree::kind<OneOf>(), begin.index());
+		for (std::size_t word = 0; word < Dispatch::WORDS; word ++) {
+			uint64_t candidates = dispatch.nullable[word];
+			if (begin != end) {
+				candidates |= dispatch.candidates[begin->id()][word];
+			}
+			while (candidates) {
+				std::size_t index = word * 64 + __builtin_ctzll(candidates);
+				uint32_t child = dispatch.builders[index](begin, end, tree);
+				if (child == FlatTree::EMPTY) {
+					tree.truncate(ret);
+					return child;
+				}
+				if (child != FlatTree::NONE) {
+					tree.link(ret, FlatTree::NONE, child);
+					tree.close(ret, child);
+					return ret;
+				}
+				candidates &= candidates - 1;
+			}
+		}
+		tree.truncate(ret);
+		return FlatTree::NONE;
 	}
 };
 
-template <class NODE>
-class ZeroOrOne : public Node
+/**
+ * A rule used before it's defined, for grammars that are recursive:
+ * a subquery inside an expression inside a query.  RULE only has to be
+ * complete once something is parsed, so it can be a class that's
+ * declared first and defined further on, deriving from its rule.
+ *
+ * The node just holds RULE's node, and is invisible to visitors and in
+ * a FlatTree.  Its Value holds RULE's value on the heap, since RULE's
+ * Value type isn't known yet where Ref is used; get() gets at it.
+ *
+ * ruleString(), first() and nullable() would go round in circles, so
+ * a Ref that's reached again while they're working on it stops there:
+ * it shows as "..." and adds nothing.  Left recursion never works, as
+ * in any recursive descent parser.
+ */
+template <class RULE>
+class Ref : public Node
 {
 private:
-	NODE* node_;
-	
-	ZeroOrOne(NODE *node) : node_(node)
+	Node *node_;
+
+	Ref(Node *node) : node_(node)
 	{}
 
+	class Guard
+	{
+	private:
+		bool& active_;
+		bool was_;
+
+	public:
+		Guard() : active_(active()), was_(active_)
+		{
+			active_ = true;
+		}
+
+		~Guard()
+		{
+			active_ = was_;
+		}
+
+		bool
+		reentered() const
+		{
+			return was_;
+		}
+
+		static bool&
+		active()
+		{
+			static thread_local bool active = false;
+			return active;
+		}
+	};
+
 public:
-	~ZeroOrOne()
+	Node *
+	node() const
 	{
-		delete node_;
+		return node_;
 	}
-	
-	std::string
-	asString(int indent = 0) const
+
+	void
+	accept(NodeVisitor& visitor) const
 	{
-		if (node_) {
-			return std::string(" [ ") + node_->asString(indent) = " ]? " ;
-		} else {
-			return std::string("");
-		}
+		node_->accept(visitor);
 	}
 
 	static std::string
 	ruleString(int indent = 0)
 	{
-		return std::string(" [ ") + NODE::ruleString(indent) + " ]? ";
+		Guard guard;
+		return guard.reentered() ? std::string("...") : RULE::ruleString(indent);
 	}
-	
-	static ZeroOrOne *
-	parse (token_iterator &begin, const token_iterator &end)
+
+	static void
+	first(FirstSet& set)
 	{
-		return new ZeroOrOne(NODE::parse(begin, end));
+		Guard guard;
+		if (!guard.reentered()) {
+			RULE::first(set);
+		}
 	}
-};
 
-template <
-	class T01=NullType,class T02=NullType,class T03=NullType,class T04=NullType,class T05=NullType,
-	class T06=NullType,class T07=NullType,class T08=NullType,class T09=NullType,class T10=NullType,
-	class T11=NullType,class T12=NullType,class T13=NullType,class T14=NullType,class T15=NullType,
-	class T16=NullType,class T17=NullType,class T18=NullType,class T19=NullType,class T20=NullType
->
-class OneOf : public Node
-{
-public:
-	typedef T01 Head;
-	typedef OneOf<T02,T03,T04,T05,T06,T07,T08,T09,T10,
-	             T11,T12,T13,T14,T15,T16,T17,T18,T19,T20> TailNode;
-
-private:
-	Node *node_;
-	
-	OneOf(Node *node) : node_(node)
-	{}
-
-public:
-	~OneOf()
+	static bool
+	nullable()
 	{
-		delete node_;
+		Guard guard;
+		return !guard.reentered() && RULE::nullable();
 	}
-	
-	std::string
-	asString(int indent = 0) const
+
+	static bool
+	match (token_iterator &begin, const token_iterator &end, MatchState& state)
 	{
-		return 
-			std::string("") 
-			+ node_->asString();
+		return RULE::match(begin, end, state);
 	}
-	
-	static std::string
-	ruleStringRest(int indent = 0)
+
+	static uint32_t
+	build (token_iterator &begin, const token_iterator &end, FlatTree& tree)
 	{
-		return std::string(" | ")
-			+ Head::ruleString(indent) 
-			+ TailNode::ruleStringRest(indent);
+		return RULE::build(begin, end, tree);
 	}
-	
-	static std::string
-	ruleString(int indent = 0)
+
+	struct Value
 	{
-		return std::string(" [ ")
-			+ Head::ruleString(indent) 
-			+ TailNode::ruleStringRest(indent)
-			+ " ] ";
-	}
-	
-	static Node *
-	parseRest (token_iterator &begin, const token_iterator&end)
+		std::shared_ptr<void> value;
+
+		template <class R = RULE>
+		const typename R::Value&
+		get() const
+		{
+			return *static_cast<const typename R::Value *>(value.get());
+		}
+	};
+
+	static bool
+	parseValue (token_iterator &begin, const token_iterator &end, Value& value)
 	{
-		Node *result = Head::parse(begin, end);
-		if (result) {
-			return result;
+		std::shared_ptr<typename RULE::Value> item = std::make_shared<typename RULE::Value>();
+		if (!RULE::parseValue(begin, end, *item)) {
+			return false;
 		}
-		return TailNode::parseRest(begin, end);
+		value.value = item;
+		return true;
 	}
-	
-	static OneOf *
-	parse (token_iterator &begin, const token_iterator &end)
+
+	static Ref *
+	parse (token_iterator &begin, const token_iterator &end, ParseContext& context)
 	{
-		Node *node = parseRest(begin,end);
-		if (node) {
-			return new OneOf(node);
+		Node *node = RULE::parse(begin, end, context);
+		return node ? new (context) Ref(node) : 0;
+	}
+
+	static void
+	resume(ResumableParse& parse, ResumableParse::Frame& frame)
+	{
+		if (!frame.state) {
+			frame.state = 1;
+			parse.call(&RULE::resume);
+			return;
 		}
-		return 0;
+		Node *node = parse.result();
+		if (!node) {
+			parse.fail();
+			return;
+		}
+		parse.succeed(new (parse.context()) Ref(node));
 	}
 };
 
 
-template <>
-class OneOf< NullType > : public Node
+/**
+ * Writes a tree in the form asString() returns: tokens as <ID>, the
+ * elements of a sequence followed by spaces, repetitions as a braced
+ * list with one indented line per item, options in brackets, and
+ * operators in expressions in parentheses with their operands.
+ */
+class TreeWriter : public NodeVisitor
 {
-public:
-	~OneOf()
-	{}
-	
-	std::string
-	asString(int indent = 0) const
+private:
+	struct Frame
 	{
-		return std::string("");
+		Node::Kind kind;
+		int indent;
+	};
+
+	Writer& out_;
+	int indent_;
+	std::vector<Frame> parents_;
+
+	// Work out the indent for a node starting now, writing the
+	// indentation a repetition puts before each item.
+	//
+	int
+	startChild()
+	{
+		if (parents_.empty()) {
+			return indent_;
+		}
+		const Frame& parent = parents_.back();
+		switch (parent.kind) {
+		case Node::REPETITION:
+			out_.repeat('\t', parent.indent);
+			return parent.indent + 1;
+		case Node::OPTION:
+			return parent.indent;
+		default:
+			return 0;
+		}
 	}
 
-	static std::string
-	ruleStringRest(int indent = 0)
+	void
+	endChild()
 	{
-		return std::string("");
+		if (parents_.empty()) {
+			return;
+		}
+		switch (parents_.back().kind) {
+		case Node::SEQUENCE:
+		case Node::EXPRESSION:
+			out_.put(' ');
+			break;
+		case Node::REPETITION:
+			out_.put('\n');
+			break;
+		default:
+			break;
+		}
 	}
-	
-	static std::string
-	ruleString(int indent = 0)
+
+public:
+	explicit
+	TreeWriter(Writer& out, int indent = 0) : out_(out), indent_(indent), parents_()
+	{}
+
+	void
+	token(const Node& node, const Token& token)
 	{
-		return std::string("");
+		startChild();
+		out_.put('<');
+		for (const char *s = token.idString(); *s; s ++) {
+			out_.put(toupper(*s));
+		}
+		out_.put('>');
+		endChild();
 	}
-	
-	static Node *
-	parseRest (token_iterator &begin, const token_iterator&end)
+
+	bool
+	enter(const Node& node, Node::Kind kind, std::size_t children)
 	{
-		return 0;
+		Frame frame = { kind, startChild() };
+		if (kind == Node::REPETITION) {
+			out_.repeat('\t', frame.indent);
+			out_.write(" { \n");
+		} else if (kind == Node::OPTION && children) {
+			out_.write(" [ ");
+		} else if (kind == Node::EXPRESSION) {
+			out_.write("( ");
+		}
+		parents_.push_back(frame);
+		return true;
 	}
 
-	static OneOf *
-	parse (token_iterator &begin, const token_iterator &end)
+	void
+	leave(const Node& node, Node::Kind kind, std::size_t children)
 	{
-		return 0;
+		int indent = parents_.back().indent;
+		parents_.pop_back();
+		if (kind == Node::REPETITION) {
+			out_.repeat('\t', indent);
+			out_.write(" }*\n");
+		} else if (kind == Node::OPTION && children) {
+			out_.write(" ]? ");
+		} else if (kind == Node::EXPRESSION) {
+			out_.put(')');
+		}
+		endChild();
 	}
 };
 
+inline void
+Node::write(Writer& out, int indent) const
+{
+	TreeWriter writer(out, indent);
+	accept(writer);
+}
+
+inline std::string
+Node::asString(int indent) const
+{
+	std::string ret;
+	{
+		Writer out(ret);
+		write(out, indent);
+	}
+	return ret;
+}
+
+/**
+ * Check whether RULE matches all the tokens from 'begin' to 'end',
+ * without building a tree.  If it doesn't, 'failure' is set to the
+ * furthest token that any rule failed at, counting tokens left over
+ * after the match as a failure where they start.
+ */
+template <class RULE>
+bool
+match(token_iterator begin, const token_iterator &end, token_iterator& failure)
+{
+	MatchState state;
+	if (RULE::match(begin, end, state) && begin == end) {
+		return true;
+	}
+	state.fail(begin);
+	failure = state.furthest;
+	return false;
+}
+
 } // PGParse
 
 #endif
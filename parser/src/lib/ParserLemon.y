@@ -1,35 +1,604 @@
+/*
+ * The core of PostgreSQL's grammar: SELECT, INSERT, UPDATE and DELETE,
+ * and CREATE TABLE, CREATE INDEX, CREATE VIEW, DROP and ALTER TABLE.
+ * The rules and precedences follow gram.y, cut down to what those
+ * statements need.
+ *
+ * Terminals are the token ids from lemonId(), and their values are
+ * indexes into the token list.  The actions build a FlatTree through
+ * the AstBuilder passed as Parse()'s extra argument; see Ast.h.
+ */
+
 %token_prefix TK_
-%token_type {int}  
-   
-%left PLUS MINUS.   
-%left SLASH STAR.  
-   
-%include {   
-#include <iostream>  
-#include <assert.h>
+%token_type {uint32_t}
+%default_type {uint32_t}
+%extra_argument {PGParse::AstBuilder *ast}
+
+/*
+ * A fixed stack, allocated with the parser, so parsing never allocates.
+ * Each level of parentheses takes a few entries; running out is a
+ * failed parse, like PostgreSQL's "stack depth limit exceeded".
+ */
+%stack_size 1000
+
+%include {
+#include <cassert>
+#include <cstdint>
 #include "ParserLemon.h"
-#include "Token.h"
-
-//using namespace PGParse;
-
-}  
-   
-%syntax_error {  
-  std::cout << "Syntax error!" << std::endl;  
-}   
-   
-program ::= expr(A).   { std::cout << "Result=" << A << std::endl; }  
-   
-expr(A) ::= expr(B) MINUS  expr(C).   { A = B - C; }  
-expr(A) ::= expr(B) PLUS  expr(C).   { A = B + C; }  
-expr(A) ::= expr(B) STAR  expr(C).   { A = B * C; }  
-expr(A) ::= expr(B) SLASH expr(C).  { 
-
-		if(C != 0){
-			A = B / C;
-		}else{
-			std::cout << "divide by zero" << std::endl;
-		}
-}  /* end of DIVIDE */
-
-expr(A) ::= INTEGER(B). { A = B; } 
\ No newline at end of file
+#include "Ast.h"
+
+namespace Ast = PGParse::Ast;
+
+static const uint32_t NO_NODE = PGParse::AstBuilder::NONE;
+}
+
+%syntax_error {
+	ast->syntaxError(TOKEN);
+}
+
+%parse_failure {
+	ast->failed = true;
+}
+
+%stack_overflow {
+	ast->failed = true;
+}
+
+/*
+ * Unreserved and column name keywords that the grammar uses are still
+ * identifiers wherever they aren't keywords.  The ones it doesn't use
+ * are mapped straight to IDENT by lemonId().
+ */
+%fallback IDENT
+	ACTION ADD_P ALTER BY CASCADE DELETE_P DOUBLE_P DROP FIRST_P IF_P
+	INDEX INSERT KEY LAST_P NO NULLS_P RENAME REPLACE RESTRICT SET TEMP
+	TEMPORARY UPDATE VARYING VIEW WITHOUT ZONE
+	BETWEEN BIGINT BIT BOOLEAN_P CHARACTER CHAR_P DEC DECIMAL_P EXISTS
+	FLOAT_P INTEGER INTERVAL INT_P NUMERIC PRECISION REAL SMALLINT TIME
+	TIMESTAMP VALUES VARCHAR.
+
+/*
+ * Lowest to highest, as in gram.y.  UMINUS is only used to give unary
+ * minus its place.  The join keywords are high so that they end a
+ * join's ON expression.
+ */
+%left UNION EXCEPT.
+%left INTERSECT.
+%left OR.
+%left AND.
+%right NOT.
+%nonassoc IS ISNULL NOTNULL.
+%nonassoc LESS GREATER EQUALS.
+%nonassoc BETWEEN IN_P LIKE ILIKE.
+%left OP.
+%left PLUS MINUS.
+%left STAR SLASH PERCENT.
+%left CARET.
+%right UMINUS.
+%left LBRACKET RBRACKET.
+%left LPAREN RPAREN.
+%left TYPECAST.
+%left DOT.
+%left JOIN CROSS LEFT FULL RIGHT INNER_P NATURAL.
+
+/*
+ * A script is any number of statements separated by semi-colons,
+ * any of which may be empty.
+ */
+input ::= stmtmulti(A).				{ ast->root = A.node; }
+
+%type stmtmulti {PGParse::AstList}
+stmtmulti(A) ::= stmt(B).			{ A = ast->list<Ast::Statements>(B); }
+stmtmulti(A) ::= stmtmulti(B) SEMI stmt(C).	{ A = ast->append(B, C); }
+
+stmt(A) ::= .					{ A = NO_NODE; }
+stmt(A) ::= select_stmt(B).			{ A = B; }
+stmt(A) ::= insert_stmt(B).			{ A = B; }
+stmt(A) ::= update_stmt(B).			{ A = B; }
+stmt(A) ::= delete_stmt(B).			{ A = B; }
+stmt(A) ::= create_table_stmt(B).		{ A = B; }
+stmt(A) ::= create_index_stmt(B).		{ A = B; }
+stmt(A) ::= create_view_stmt(B).		{ A = B; }
+stmt(A) ::= drop_stmt(B).			{ A = B; }
+stmt(A) ::= alter_table_stmt(B).		{ A = B; }
+
+/*
+ * SELECT
+ */
+select_stmt(A) ::= select_no_parens(B).		{ A = B; }
+select_stmt(A) ::= select_with_parens(B).	{ A = B; }
+
+select_with_parens(A) ::= LPAREN(S) select_no_parens(B) RPAREN(E).	{ A = ast->extend(B, S, E); }
+select_with_parens(A) ::= LPAREN(S) select_with_parens(B) RPAREN(E).	{ A = ast->extend(B, S, E); }
+
+select_no_parens(A) ::= simple_select(B).	{ A = B; }
+select_no_parens(A) ::= select_clause(B) sort_clause(C).
+	{ A = ast->make<Ast::Query>(NO_NODE, NO_NODE, B, C); }
+select_no_parens(A) ::= select_clause(B) opt_sort_clause(C) select_limit(D).
+	{ A = ast->make<Ast::Query>(NO_NODE, NO_NODE, B, C, D); }
+
+select_clause(A) ::= simple_select(B).		{ A = B; }
+select_clause(A) ::= select_with_parens(B).	{ A = B; }
+
+simple_select(A) ::= SELECT(S) opt_distinct(B) target_list(C) from_clause(D) where_clause(E) group_clause(F) having_clause(G).
+	{ A = ast->make<Ast::Select>(S, S, B, C.node, D, E, F, G); }
+simple_select(A) ::= values_clause(B).		{ A = B.node; }
+simple_select(A) ::= select_clause(B) UNION(O) all_or_distinct(C) select_clause(D).
+	{ A = ast->make<Ast::SetOperation>(O, O, B, C, D); }
+simple_select(A) ::= select_clause(B) INTERSECT(O) all_or_distinct(C) select_clause(D).
+	{ A = ast->make<Ast::SetOperation>(O, O, B, C, D); }
+simple_select(A) ::= select_clause(B) EXCEPT(O) all_or_distinct(C) select_clause(D).
+	{ A = ast->make<Ast::SetOperation>(O, O, B, C, D); }
+
+all_or_distinct(A) ::= ALL(B).			{ A = ast->leaf<Ast::Distinct>(B); }
+all_or_distinct(A) ::= DISTINCT(B).		{ A = ast->leaf<Ast::Distinct>(B); }
+all_or_distinct(A) ::= .			{ A = NO_NODE; }
+
+opt_distinct(A) ::= DISTINCT(B).		{ A = ast->leaf<Ast::Distinct>(B); }
+opt_distinct(A) ::= DISTINCT(B) ON LPAREN expr_list(C) RPAREN(E).
+	{ A = ast->make<Ast::Distinct>(B, E, C.node); }
+opt_distinct(A) ::= ALL(B).			{ A = ast->leaf<Ast::Distinct>(B); }
+opt_distinct(A) ::= .				{ A = NO_NODE; }
+
+%type target_list {PGParse::AstList}
+target_list(A) ::= target_el(B).		{ A = ast->list<Ast::Targets>(B); }
+target_list(A) ::= target_list(B) COMMA target_el(C).	{ A = ast->append(B, C); }
+
+target_el(A) ::= a_expr(B) AS col_id(C).	{ A = ast->make<Ast::Target>(NO_NODE, NO_NODE, B, C); }
+target_el(A) ::= a_expr(B) IDENT(C).
+	{ A = ast->make<Ast::Target>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Identifier>(C)); }
+target_el(A) ::= a_expr(B).			{ A = ast->make<Ast::Target>(NO_NODE, NO_NODE, B); }
+target_el(A) ::= STAR(B).			{ A = ast->make<Ast::Target>(NO_NODE, NO_NODE, ast->leaf<Ast::Star>(B)); }
+
+values_clause(A) ::= VALUES(V) LPAREN expr_list(B) RPAREN(E).
+	{ A = ast->list<Ast::Values>(ast->make<Ast::Row>(V, E, B.node)); }
+values_clause(A) ::= values_clause(B) COMMA LPAREN(S) expr_list(C) RPAREN(E).
+	{ A = ast->append(B, ast->make<Ast::Row>(S, E, C.node)); }
+%type values_clause {PGParse::AstList}
+
+from_clause(A) ::= FROM(F) from_list(B).	{ A = ast->extend(B.node, F, F); }
+from_clause(A) ::= .				{ A = NO_NODE; }
+
+%type from_list {PGParse::AstList}
+from_list(A) ::= table_ref(B).			{ A = ast->list<Ast::From>(B); }
+from_list(A) ::= from_list(B) COMMA table_ref(C).	{ A = ast->append(B, C); }
+
+table_ref(A) ::= qualified_name(B) opt_alias_clause(C).
+	{ A = ast->make<Ast::TableRef>(NO_NODE, NO_NODE, B, C); }
+table_ref(A) ::= select_with_parens(B) opt_alias_clause(C).
+	{ A = ast->make<Ast::TableRef>(NO_NODE, NO_NODE, ast->make<Ast::Subquery>(NO_NODE, NO_NODE, B), C); }
+table_ref(A) ::= joined_table(B).		{ A = B; }
+table_ref(A) ::= LPAREN(S) joined_table(B) RPAREN alias_clause(C).
+	{ A = ast->make<Ast::TableRef>(S, NO_NODE, B, C); }
+
+joined_table(A) ::= LPAREN(S) joined_table(B) RPAREN(E).
+	{ A = ast->make<Ast::TableRef>(S, E, B); }
+joined_table(A) ::= table_ref(B) CROSS(J) JOIN table_ref(C).
+	{ A = ast->make<Ast::Join>(NO_NODE, NO_NODE, B, ast->leaf<Ast::JoinType>(J), C); }
+joined_table(A) ::= table_ref(B) join_type(J) JOIN table_ref(C) join_qual(D).
+	{ A = ast->make<Ast::Join>(NO_NODE, NO_NODE, B, J, C, D); }
+joined_table(A) ::= table_ref(B) JOIN table_ref(C) join_qual(D).
+	{ A = ast->make<Ast::Join>(NO_NODE, NO_NODE, B, C, D); }
+joined_table(A) ::= table_ref(B) NATURAL(N) join_type(J) JOIN table_ref(C).
+	{ A = ast->make<Ast::Join>(NO_NODE, NO_NODE, B, ast->make<Ast::JoinType>(N, NO_NODE, J), C); }
+joined_table(A) ::= table_ref(B) NATURAL(N) JOIN table_ref(C).
+	{ A = ast->make<Ast::Join>(NO_NODE, NO_NODE, B, ast->leaf<Ast::JoinType>(N), C); }
+
+join_type(A) ::= FULL(B) join_outer(C).		{ A = ast->make<Ast::JoinType>(B, C); }
+join_type(A) ::= LEFT(B) join_outer(C).		{ A = ast->make<Ast::JoinType>(B, C); }
+join_type(A) ::= RIGHT(B) join_outer(C).	{ A = ast->make<Ast::JoinType>(B, C); }
+join_type(A) ::= INNER_P(B).			{ A = ast->leaf<Ast::JoinType>(B); }
+
+join_outer(A) ::= OUTER_P(B).			{ A = B; }
+join_outer(A) ::= .				{ A = NO_NODE; }
+
+join_qual(A) ::= USING(U) LPAREN name_list(B) RPAREN(E).	{ A = ast->extend(B.node, U, E); }
+join_qual(A) ::= ON(O) a_expr(B).		{ A = ast->make<Ast::Where>(O, O, B); }
+
+alias_clause(A) ::= AS col_id(B).		{ A = B; }
+alias_clause(A) ::= IDENT(B).			{ A = ast->leaf<Ast::Identifier>(B); }
+
+opt_alias_clause(A) ::= alias_clause(B).	{ A = B; }
+opt_alias_clause(A) ::= .			{ A = NO_NODE; }
+
+where_clause(A) ::= WHERE(W) a_expr(B).		{ A = ast->make<Ast::Where>(W, W, B); }
+where_clause(A) ::= .				{ A = NO_NODE; }
+
+group_clause(A) ::= GROUP_P(G) BY expr_list(B).	{ A = ast->make<Ast::GroupBy>(G, NO_NODE, B.node); }
+group_clause(A) ::= .				{ A = NO_NODE; }
+
+having_clause(A) ::= HAVING(H) a_expr(B).	{ A = ast->make<Ast::Having>(H, H, B); }
+having_clause(A) ::= .				{ A = NO_NODE; }
+
+sort_clause(A) ::= ORDER(O) BY sortby_list(B).	{ A = ast->extend(B.node, O, NO_NODE); }
+
+opt_sort_clause(A) ::= sort_clause(B).		{ A = B; }
+opt_sort_clause(A) ::= .			{ A = NO_NODE; }
+
+%type sortby_list {PGParse::AstList}
+sortby_list(A) ::= sortby(B).			{ A = ast->list<Ast::OrderBy>(B); }
+sortby_list(A) ::= sortby_list(B) COMMA sortby(C).	{ A = ast->append(B, C); }
+
+sortby(A) ::= a_expr(B) opt_asc_desc(C) opt_nulls_order(D).
+	{ A = ast->make<Ast::SortBy>(NO_NODE, NO_NODE, B, C, D); }
+
+opt_asc_desc(A) ::= ASC(B).			{ A = ast->leaf<Ast::Direction>(B); }
+opt_asc_desc(A) ::= DESC(B).			{ A = ast->leaf<Ast::Direction>(B); }
+opt_asc_desc(A) ::= .				{ A = NO_NODE; }
+
+opt_nulls_order(A) ::= NULLS_P(B) FIRST_P(C).	{ A = ast->make<Ast::Direction>(B, C); }
+opt_nulls_order(A) ::= NULLS_P(B) LAST_P(C).	{ A = ast->make<Ast::Direction>(B, C); }
+opt_nulls_order(A) ::= .			{ A = NO_NODE; }
+
+select_limit(A) ::= limit_clause(B) offset_clause(C).	{ A = ast->make<Ast::Limit>(NO_NODE, NO_NODE, B, C); }
+select_limit(A) ::= offset_clause(B) limit_clause(C).	{ A = ast->make<Ast::Limit>(NO_NODE, NO_NODE, B, C); }
+select_limit(A) ::= limit_clause(B).			{ A = B; }
+select_limit(A) ::= offset_clause(B).			{ A = B; }
+
+limit_clause(A) ::= LIMIT(L) a_expr(B).		{ A = ast->make<Ast::Limit>(L, L, B); }
+limit_clause(A) ::= LIMIT(L) ALL(B).		{ A = ast->make<Ast::Limit>(L, B); }
+
+offset_clause(A) ::= OFFSET(O) a_expr(B).	{ A = ast->make<Ast::Offset>(O, O, B); }
+
+/*
+ * INSERT, UPDATE and DELETE
+ */
+insert_stmt(A) ::= INSERT(I) INTO qualified_name(B) select_stmt(C) returning_clause(D).
+	{ A = ast->make<Ast::Insert>(I, I, B, C, D); }
+insert_stmt(A) ::= INSERT(I) INTO qualified_name(B) LPAREN(S) name_list(C) RPAREN(E) select_stmt(D) returning_clause(F).
+	{ A = ast->make<Ast::Insert>(I, I, B, ast->extend(C.node, S, E), D, F); }
+insert_stmt(A) ::= INSERT(I) INTO qualified_name(B) DEFAULT(S) VALUES(E) returning_clause(C).
+	{ A = ast->make<Ast::Insert>(I, I, B, ast->make<Ast::DefaultValues>(S, E), C); }
+
+returning_clause(A) ::= RETURNING(R) target_list(B).	{ A = ast->make<Ast::Returning>(R, R, B.node); }
+returning_clause(A) ::= .				{ A = NO_NODE; }
+
+update_stmt(A) ::= UPDATE(U) relation_opt_alias(B) SET set_clause_list(C) from_clause(D) where_clause(E) returning_clause(F).
+	{ A = ast->make<Ast::Update>(U, U, B, C.node, D, E, F); }
+
+%type set_clause_list {PGParse::AstList}
+set_clause_list(A) ::= set_clause(B).		{ A = ast->list<Ast::SetClauses>(B); }
+set_clause_list(A) ::= set_clause_list(B) COMMA set_clause(C).	{ A = ast->append(B, C); }
+
+set_clause(A) ::= col_id(B) EQUALS a_expr(C).	{ A = ast->make<Ast::SetClause>(NO_NODE, NO_NODE, B, C); }
+set_clause(A) ::= col_id(B) EQUALS DEFAULT(C).
+	{ A = ast->make<Ast::SetClause>(NO_NODE, NO_NODE, B, ast->leaf<Ast::DefaultValues>(C)); }
+
+delete_stmt(A) ::= DELETE_P(D) FROM relation_opt_alias(B) using_clause(C) where_clause(E) returning_clause(F).
+	{ A = ast->make<Ast::Delete>(D, D, B, C, E, F); }
+
+using_clause(A) ::= USING(U) from_list(B).	{ A = ast->extend(B.node, U, U); }
+using_clause(A) ::= .				{ A = NO_NODE; }
+
+relation_opt_alias(A) ::= qualified_name(B).	{ A = ast->make<Ast::TableRef>(NO_NODE, NO_NODE, B); }
+relation_opt_alias(A) ::= qualified_name(B) alias_clause(C).
+	{ A = ast->make<Ast::TableRef>(NO_NODE, NO_NODE, B, C); }
+
+/*
+ * DDL
+ */
+create_table_stmt(A) ::= CREATE(C) opt_temp(T) TABLE opt_if_not_exists(I) qualified_name(B) LPAREN opt_table_element_list(D) RPAREN(E).
+	{ A = ast->make<Ast::CreateTable>(C, E, T, I, B, D); }
+
+opt_temp(A) ::= TEMPORARY(B).			{ A = ast->leaf<Ast::Option>(B); }
+opt_temp(A) ::= TEMP(B).			{ A = ast->leaf<Ast::Option>(B); }
+opt_temp(A) ::= .				{ A = NO_NODE; }
+
+opt_if_not_exists(A) ::= IF_P(B) NOT EXISTS(C).	{ A = ast->make<Ast::Option>(B, C); }
+opt_if_not_exists(A) ::= .			{ A = NO_NODE; }
+
+opt_table_element_list(A) ::= table_element_list(B).	{ A = B.node; }
+opt_table_element_list(A) ::= .			{ A = NO_NODE; }
+
+%type table_element_list {PGParse::AstList}
+table_element_list(A) ::= table_element(B).	{ A = ast->list<Ast::TableElements>(B); }
+table_element_list(A) ::= table_element_list(B) COMMA table_element(C).	{ A = ast->append(B, C); }
+
+table_element(A) ::= column_def(B).		{ A = B; }
+table_element(A) ::= table_constraint(B).	{ A = B; }
+
+column_def(A) ::= col_id(B) typename(C) col_qual_list(D).
+	{ A = ast->make<Ast::ColumnDef>(NO_NODE, NO_NODE, B, C, D.node); }
+
+%type col_qual_list {PGParse::AstList}
+col_qual_list(A) ::= .				{ A = ast->list<Ast::Constraints>(NO_NODE); }
+col_qual_list(A) ::= col_qual_list(B) col_constraint(C).	{ A = ast->append(B, C); }
+
+col_constraint(A) ::= CONSTRAINT(C) col_id(B) col_constraint_elem(D).
+	{ A = ast->make<Ast::Constraint>(C, C, B, D); }
+col_constraint(A) ::= col_constraint_elem(B).	{ A = B; }
+
+col_constraint_elem(A) ::= NOT(B) NULL_P(C).	{ A = ast->make<Ast::Constraint>(B, C); }
+col_constraint_elem(A) ::= NULL_P(B).		{ A = ast->make<Ast::Constraint>(B, B); }
+col_constraint_elem(A) ::= UNIQUE(B).		{ A = ast->make<Ast::Constraint>(B, B); }
+col_constraint_elem(A) ::= PRIMARY(B) KEY(C).	{ A = ast->make<Ast::Constraint>(B, C); }
+col_constraint_elem(A) ::= CHECK(B) LPAREN a_expr(C) RPAREN(E).
+	{ A = ast->make<Ast::Constraint>(B, E, C); }
+col_constraint_elem(A) ::= DEFAULT(B) b_expr(C).	{ A = ast->make<Ast::Constraint>(B, B, C); }
+col_constraint_elem(A) ::= references(B).	{ A = B; }
+
+references(A) ::= REFERENCES(R) qualified_name(B) opt_column_list(C) key_actions(D).
+	{ A = ast->make<Ast::References>(R, R, B, C, D.node); }
+
+%type key_actions {PGParse::AstList}
+key_actions(A) ::= .				{ A = ast->list<Ast::Constraints>(NO_NODE); }
+key_actions(A) ::= key_actions(B) ON(O) key_event key_action(C).
+	{ A = ast->append(B, ast->make<Ast::Option>(O, C)); }
+
+key_event ::= UPDATE.
+key_event ::= DELETE_P.
+
+key_action(A) ::= NO ACTION(B).			{ A = B; }
+key_action(A) ::= RESTRICT(B).			{ A = B; }
+key_action(A) ::= CASCADE(B).			{ A = B; }
+key_action(A) ::= SET NULL_P(B).		{ A = B; }
+key_action(A) ::= SET DEFAULT(B).		{ A = B; }
+
+table_constraint(A) ::= CONSTRAINT(C) col_id(B) constraint_elem(D).
+	{ A = ast->make<Ast::Constraint>(C, C, B, D); }
+table_constraint(A) ::= constraint_elem(B).	{ A = B; }
+
+constraint_elem(A) ::= UNIQUE(B) LPAREN name_list(C) RPAREN(E).
+	{ A = ast->make<Ast::Constraint>(B, E, C.node); }
+constraint_elem(A) ::= PRIMARY(B) KEY LPAREN name_list(C) RPAREN(E).
+	{ A = ast->make<Ast::Constraint>(B, E, C.node); }
+constraint_elem(A) ::= CHECK(B) LPAREN a_expr(C) RPAREN(E).
+	{ A = ast->make<Ast::Constraint>(B, E, C); }
+constraint_elem(A) ::= FOREIGN(B) KEY LPAREN name_list(C) RPAREN references(D).
+	{ A = ast->make<Ast::Constraint>(B, NO_NODE, C.node, D); }
+
+create_index_stmt(A) ::= CREATE(C) opt_unique(U) INDEX opt_index_name(N) ON qualified_name(B) LPAREN index_params(D) RPAREN(E) where_clause(W).
+	{ A = ast->make<Ast::CreateIndex>(C, E, U, N, B, D.node, W); }
+
+opt_unique(A) ::= UNIQUE(B).			{ A = ast->leaf<Ast::Option>(B); }
+opt_unique(A) ::= .				{ A = NO_NODE; }
+
+opt_index_name(A) ::= col_id(B).		{ A = B; }
+opt_index_name(A) ::= .				{ A = NO_NODE; }
+
+%type index_params {PGParse::AstList}
+index_params(A) ::= index_elem(B).		{ A = ast->list<Ast::IndexElements>(B); }
+index_params(A) ::= index_params(B) COMMA index_elem(C).	{ A = ast->append(B, C); }
+
+index_elem(A) ::= col_id(B) opt_asc_desc(C).	{ A = ast->make<Ast::SortBy>(NO_NODE, NO_NODE, B, C); }
+index_elem(A) ::= LPAREN a_expr(B) RPAREN opt_asc_desc(C).
+	{ A = ast->make<Ast::SortBy>(NO_NODE, NO_NODE, B, C); }
+
+create_view_stmt(A) ::= CREATE(C) opt_temp(T) VIEW qualified_name(B) opt_column_list(D) AS select_stmt(E).
+	{ A = ast->make<Ast::CreateView>(C, C, T, B, D, E); }
+create_view_stmt(A) ::= CREATE(C) OR(O) REPLACE(R) opt_temp(T) VIEW qualified_name(B) opt_column_list(D) AS select_stmt(E).
+	{ A = ast->make<Ast::CreateView>(C, C, ast->make<Ast::Option>(O, R), T, B, D, E); }
+
+drop_stmt(A) ::= DROP(D) drop_type(T) IF_P(I) EXISTS(E) any_name_list(B) opt_drop_behavior(C).
+	{ A = ast->make<Ast::Drop>(D, D, T, ast->make<Ast::Option>(I, E), B.node, C); }
+drop_stmt(A) ::= DROP(D) drop_type(T) any_name_list(B) opt_drop_behavior(C).
+	{ A = ast->make<Ast::Drop>(D, D, T, B.node, C); }
+
+drop_type(A) ::= TABLE(B).			{ A = ast->leaf<Ast::Option>(B); }
+drop_type(A) ::= VIEW(B).			{ A = ast->leaf<Ast::Option>(B); }
+drop_type(A) ::= INDEX(B).			{ A = ast->leaf<Ast::Option>(B); }
+
+%type any_name_list {PGParse::AstList}
+any_name_list(A) ::= qualified_name(B).		{ A = ast->list<Ast::Names>(B); }
+any_name_list(A) ::= any_name_list(B) COMMA qualified_name(C).	{ A = ast->append(B, C); }
+
+opt_drop_behavior(A) ::= CASCADE(B).		{ A = ast->leaf<Ast::Option>(B); }
+opt_drop_behavior(A) ::= RESTRICT(B).		{ A = ast->leaf<Ast::Option>(B); }
+opt_drop_behavior(A) ::= .			{ A = NO_NODE; }
+
+alter_table_stmt(A) ::= ALTER(L) TABLE qualified_name(B) alter_table_cmds(C).
+	{ A = ast->make<Ast::AlterTable>(L, L, B, C.node); }
+
+%type alter_table_cmds {PGParse::AstList}
+alter_table_cmds(A) ::= alter_table_cmd(B).	{ A = ast->list<Ast::AlterCommands>(B); }
+alter_table_cmds(A) ::= alter_table_cmds(B) COMMA alter_table_cmd(C).	{ A = ast->append(B, C); }
+
+alter_table_cmd(A) ::= ADD_P(D) column_def(B).	{ A = ast->make<Ast::AlterCommand>(D, D, B); }
+alter_table_cmd(A) ::= ADD_P(D) COLUMN column_def(B).	{ A = ast->make<Ast::AlterCommand>(D, D, B); }
+alter_table_cmd(A) ::= ADD_P(D) table_constraint(B).	{ A = ast->make<Ast::AlterCommand>(D, D, B); }
+alter_table_cmd(A) ::= DROP(D) col_id(B) opt_drop_behavior(C).
+	{ A = ast->make<Ast::AlterCommand>(D, D, B, C); }
+alter_table_cmd(A) ::= DROP(D) COLUMN col_id(B) opt_drop_behavior(C).
+	{ A = ast->make<Ast::AlterCommand>(D, D, B, C); }
+alter_table_cmd(A) ::= RENAME(R) TO col_id(B).	{ A = ast->make<Ast::AlterCommand>(R, R, B); }
+alter_table_cmd(A) ::= RENAME(R) col_id(B) TO col_id(C).
+	{ A = ast->make<Ast::AlterCommand>(R, R, B, C); }
+alter_table_cmd(A) ::= RENAME(R) COLUMN col_id(B) TO col_id(C).
+	{ A = ast->make<Ast::AlterCommand>(R, R, B, C); }
+
+/*
+ * Names and types
+ */
+col_id(A) ::= IDENT(B).				{ A = ast->leaf<Ast::Identifier>(B); }
+
+qualified_name(A) ::= col_id(B).		{ A = ast->make<Ast::Name>(NO_NODE, NO_NODE, B); }
+qualified_name(A) ::= col_id(B) DOT col_id(C).	{ A = ast->make<Ast::Name>(NO_NODE, NO_NODE, B, C); }
+
+%type name_list {PGParse::AstList}
+name_list(A) ::= col_id(B).			{ A = ast->list<Ast::Columns>(B); }
+name_list(A) ::= name_list(B) COMMA col_id(C).	{ A = ast->append(B, C); }
+
+opt_column_list(A) ::= LPAREN(S) name_list(B) RPAREN(E).	{ A = ast->extend(B.node, S, E); }
+opt_column_list(A) ::= .			{ A = NO_NODE; }
+
+typename(A) ::= simple_typename(B) opt_array_bounds(C).	{ A = ast->extend(B, NO_NODE, C); }
+
+opt_array_bounds(A) ::= opt_array_bounds LBRACKET RBRACKET(B).		{ A = B; }
+opt_array_bounds(A) ::= opt_array_bounds LBRACKET ICONST RBRACKET(B).	{ A = B; }
+opt_array_bounds(A) ::= .						{ A = NO_NODE; }
+
+simple_typename(A) ::= qualified_name(B) opt_type_modifiers(C).
+	{ A = ast->make<Ast::TypeName>(NO_NODE, NO_NODE, B, C); }
+simple_typename(A) ::= INT_P(B).		{ A = ast->leaf<Ast::TypeName>(B); }
+simple_typename(A) ::= INTEGER(B).		{ A = ast->leaf<Ast::TypeName>(B); }
+simple_typename(A) ::= SMALLINT(B).		{ A = ast->leaf<Ast::TypeName>(B); }
+simple_typename(A) ::= BIGINT(B).		{ A = ast->leaf<Ast::TypeName>(B); }
+simple_typename(A) ::= REAL(B).			{ A = ast->leaf<Ast::TypeName>(B); }
+simple_typename(A) ::= BOOLEAN_P(B).		{ A = ast->leaf<Ast::TypeName>(B); }
+simple_typename(A) ::= FLOAT_P(B) opt_type_modifiers(C).	{ A = ast->make<Ast::TypeName>(B, B, C); }
+simple_typename(A) ::= DOUBLE_P(B) PRECISION(C).	{ A = ast->make<Ast::TypeName>(B, C); }
+simple_typename(A) ::= DECIMAL_P(B) opt_type_modifiers(C).	{ A = ast->make<Ast::TypeName>(B, B, C); }
+simple_typename(A) ::= DEC(B) opt_type_modifiers(C).	{ A = ast->make<Ast::TypeName>(B, B, C); }
+simple_typename(A) ::= NUMERIC(B) opt_type_modifiers(C).	{ A = ast->make<Ast::TypeName>(B, B, C); }
+simple_typename(A) ::= VARCHAR(B) opt_type_modifiers(C).	{ A = ast->make<Ast::TypeName>(B, B, C); }
+simple_typename(A) ::= character(B) opt_type_modifiers(C).	{ A = ast->make<Ast::TypeName>(NO_NODE, NO_NODE, B, C); }
+simple_typename(A) ::= BIT(B) opt_varying(V) opt_type_modifiers(C).	{ A = ast->make<Ast::TypeName>(B, V, C); }
+simple_typename(A) ::= TIMESTAMP(B) opt_type_modifiers(C) opt_timezone(D).	{ A = ast->make<Ast::TypeName>(B, D, C); }
+simple_typename(A) ::= TIME(B) opt_type_modifiers(C) opt_timezone(D).	{ A = ast->make<Ast::TypeName>(B, D, C); }
+simple_typename(A) ::= INTERVAL(B).		{ A = ast->leaf<Ast::TypeName>(B); }
+
+character(A) ::= CHARACTER(B) opt_varying(C).	{ A = ast->make<Ast::TypeName>(B, C); }
+character(A) ::= CHAR_P(B) opt_varying(C).	{ A = ast->make<Ast::TypeName>(B, C); }
+
+opt_varying(A) ::= VARYING(B).			{ A = B; }
+opt_varying(A) ::= .				{ A = NO_NODE; }
+
+opt_timezone(A) ::= WITH TIME ZONE(B).		{ A = B; }
+opt_timezone(A) ::= WITHOUT TIME ZONE(B).	{ A = B; }
+opt_timezone(A) ::= .				{ A = NO_NODE; }
+
+opt_type_modifiers(A) ::= LPAREN(S) expr_list(B) RPAREN(E).	{ A = ast->extend(B.node, S, E); }
+opt_type_modifiers(A) ::= .			{ A = NO_NODE; }
+
+/*
+ * Expressions.  b_expr is a_expr without the boolean operators and
+ * predicates, for places like DEFAULT where a following NOT NULL
+ * would otherwise be ambiguous.
+ */
+a_expr(A) ::= c_expr(B).			{ A = B; }
+a_expr(A) ::= a_expr(B) TYPECAST(O) typename(C).
+	{ A = ast->make<Ast::Cast>(O, O, B, C); }
+a_expr(A) ::= PLUS(O) a_expr(B).	[UMINUS]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, ast->leaf<Ast::Operator>(O), B); }
+a_expr(A) ::= MINUS(O) a_expr(B).	[UMINUS]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, ast->leaf<Ast::Operator>(O), B); }
+a_expr(A) ::= OP(O) a_expr(B).		[OP]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, ast->leaf<Ast::Operator>(O), B); }
+a_expr(A) ::= NOT(O) a_expr(B).
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, ast->leaf<Ast::Operator>(O), B); }
+a_expr(A) ::= a_expr(B) PLUS(O) a_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) MINUS(O) a_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) STAR(O) a_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) SLASH(O) a_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) PERCENT(O) a_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) CARET(O) a_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) LESS(O) a_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) GREATER(O) a_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) EQUALS(O) a_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) OP(O) a_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) AND(O) a_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) OR(O) a_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) LIKE(O) a_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) NOT(O) LIKE(P) a_expr(C).	[LIKE]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->make<Ast::Operator>(O, P), C); }
+a_expr(A) ::= a_expr(B) ILIKE(O) a_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) NOT(O) ILIKE(P) a_expr(C).	[ILIKE]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->make<Ast::Operator>(O, P), C); }
+a_expr(A) ::= a_expr(B) IS(O) NULL_P(P).	[IS]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->make<Ast::Operator>(O, P)); }
+a_expr(A) ::= a_expr(B) IS(O) NOT NULL_P(P).	[IS]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->make<Ast::Operator>(O, P)); }
+a_expr(A) ::= a_expr(B) IS(O) TRUE_P(P).	[IS]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->make<Ast::Operator>(O, P)); }
+a_expr(A) ::= a_expr(B) IS(O) NOT TRUE_P(P).	[IS]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->make<Ast::Operator>(O, P)); }
+a_expr(A) ::= a_expr(B) IS(O) FALSE_P(P).	[IS]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->make<Ast::Operator>(O, P)); }
+a_expr(A) ::= a_expr(B) IS(O) NOT FALSE_P(P).	[IS]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->make<Ast::Operator>(O, P)); }
+a_expr(A) ::= a_expr(B) ISNULL(O).
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O)); }
+a_expr(A) ::= a_expr(B) NOTNULL(O).
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O)); }
+a_expr(A) ::= a_expr(B) BETWEEN(O) b_expr(C) AND b_expr(D).	[BETWEEN]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C, D); }
+a_expr(A) ::= a_expr(B) NOT(O) BETWEEN(P) b_expr(C) AND b_expr(D).	[BETWEEN]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->make<Ast::Operator>(O, P), C, D); }
+a_expr(A) ::= a_expr(B) IN_P(O) in_expr(C).
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+a_expr(A) ::= a_expr(B) NOT(O) IN_P(P) in_expr(C).	[IN_P]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->make<Ast::Operator>(O, P), C); }
+
+in_expr(A) ::= select_with_parens(B).		{ A = ast->make<Ast::Subquery>(NO_NODE, NO_NODE, B); }
+in_expr(A) ::= LPAREN(S) expr_list(B) RPAREN(E).	{ A = ast->extend(B.node, S, E); }
+
+b_expr(A) ::= c_expr(B).			{ A = B; }
+b_expr(A) ::= b_expr(B) TYPECAST(O) typename(C).
+	{ A = ast->make<Ast::Cast>(O, O, B, C); }
+b_expr(A) ::= PLUS(O) b_expr(B).	[UMINUS]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, ast->leaf<Ast::Operator>(O), B); }
+b_expr(A) ::= MINUS(O) b_expr(B).	[UMINUS]
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, ast->leaf<Ast::Operator>(O), B); }
+b_expr(A) ::= b_expr(B) PLUS(O) b_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+b_expr(A) ::= b_expr(B) MINUS(O) b_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+b_expr(A) ::= b_expr(B) STAR(O) b_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+b_expr(A) ::= b_expr(B) SLASH(O) b_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+b_expr(A) ::= b_expr(B) PERCENT(O) b_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+b_expr(A) ::= b_expr(B) CARET(O) b_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+b_expr(A) ::= b_expr(B) LESS(O) b_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+b_expr(A) ::= b_expr(B) GREATER(O) b_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+b_expr(A) ::= b_expr(B) EQUALS(O) b_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+b_expr(A) ::= b_expr(B) OP(O) b_expr(C).	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Operator>(O), C); }
+
+c_expr(A) ::= columnref(B).			{ A = B; }
+c_expr(A) ::= aexpr_const(B).			{ A = B; }
+c_expr(A) ::= PARAM(B).				{ A = ast->leaf<Ast::Param>(B); }
+c_expr(A) ::= LPAREN a_expr(B) RPAREN.		{ A = B; }
+c_expr(A) ::= func_expr(B).			{ A = B; }
+c_expr(A) ::= select_with_parens(B).	[UMINUS]
+	{ A = ast->make<Ast::Subquery>(NO_NODE, NO_NODE, B); }
+c_expr(A) ::= EXISTS(O) select_with_parens(B).
+	{ A = ast->make<Ast::Operation>(NO_NODE, NO_NODE, ast->leaf<Ast::Operator>(O), ast->make<Ast::Subquery>(NO_NODE, NO_NODE, B)); }
+c_expr(A) ::= case_expr(B).			{ A = B; }
+c_expr(A) ::= CAST(C) LPAREN a_expr(B) AS typename(D) RPAREN(E).
+	{ A = ast->make<Ast::Cast>(C, E, B, D); }
+
+columnref(A) ::= col_id(B).			{ A = ast->make<Ast::Name>(NO_NODE, NO_NODE, B); }
+columnref(A) ::= col_id(B) DOT col_id(C).	{ A = ast->make<Ast::Name>(NO_NODE, NO_NODE, B, C); }
+columnref(A) ::= col_id(B) DOT col_id(C) DOT col_id(D).
+	{ A = ast->make<Ast::Name>(NO_NODE, NO_NODE, B, C, D); }
+columnref(A) ::= col_id(B) DOT STAR(C).		{ A = ast->make<Ast::Name>(NO_NODE, NO_NODE, B, ast->leaf<Ast::Star>(C)); }
+
+aexpr_const(A) ::= ICONST(B).			{ A = ast->leaf<Ast::Constant>(B); }
+aexpr_const(A) ::= FCONST(B).			{ A = ast->leaf<Ast::Constant>(B); }
+aexpr_const(A) ::= SCONST(B).			{ A = ast->leaf<Ast::Constant>(B); }
+aexpr_const(A) ::= TRUE_P(B).			{ A = ast->leaf<Ast::Constant>(B); }
+aexpr_const(A) ::= FALSE_P(B).			{ A = ast->leaf<Ast::Constant>(B); }
+aexpr_const(A) ::= NULL_P(B).			{ A = ast->leaf<Ast::Constant>(B); }
+aexpr_const(A) ::= func_name(B) SCONST(C).
+	{ A = ast->make<Ast::Cast>(NO_NODE, NO_NODE, ast->leaf<Ast::Constant>(C), ast->make<Ast::TypeName>(NO_NODE, NO_NODE, B)); }
+aexpr_const(A) ::= INTERVAL(B) SCONST(C).
+	{ A = ast->make<Ast::Cast>(NO_NODE, NO_NODE, ast->leaf<Ast::Constant>(C), ast->leaf<Ast::TypeName>(B)); }
+aexpr_const(A) ::= TIMESTAMP(B) SCONST(C).
+	{ A = ast->make<Ast::Cast>(NO_NODE, NO_NODE, ast->leaf<Ast::Constant>(C), ast->leaf<Ast::TypeName>(B)); }
+
+func_name(A) ::= col_id(B).			{ A = ast->make<Ast::Name>(NO_NODE, NO_NODE, B); }
+func_name(A) ::= col_id(B) DOT col_id(C).	{ A = ast->make<Ast::Name>(NO_NODE, NO_NODE, B, C); }
+
+func_expr(A) ::= func_name(B) LPAREN RPAREN(E).
+	{ A = ast->make<Ast::FuncCall>(NO_NODE, E, B); }
+func_expr(A) ::= func_name(B) LPAREN STAR(C) RPAREN(E).
+	{ A = ast->make<Ast::FuncCall>(NO_NODE, E, B, ast->leaf<Ast::Star>(C)); }
+func_expr(A) ::= func_name(B) LPAREN expr_list(C) RPAREN(E).
+	{ A = ast->make<Ast::FuncCall>(NO_NODE, E, B, C.node); }
+func_expr(A) ::= func_name(B) LPAREN DISTINCT(D) expr_list(C) RPAREN(E).
+	{ A = ast->make<Ast::FuncCall>(NO_NODE, E, B, ast->leaf<Ast::Distinct>(D), C.node); }
+
+case_expr(A) ::= CASE(C) case_arg(B) when_clause_list(D) case_default(E) END_P(F).
+	{ A = ast->make<Ast::Case>(C, F, B, D.node, E); }
+
+case_arg(A) ::= a_expr(B).			{ A = B; }
+case_arg(A) ::= .				{ A = NO_NODE; }
+
+%type when_clause_list {PGParse::AstList}
+when_clause_list(A) ::= when_clause(B).		{ A = ast->list<Ast::ExprList>(B); }
+when_clause_list(A) ::= when_clause_list(B) when_clause(C).	{ A = ast->append(B, C); }
+
+when_clause(A) ::= WHEN(W) a_expr(B) THEN a_expr(C).	{ A = ast->make<Ast::When>(W, W, B, C); }
+
+case_default(A) ::= ELSE(E) a_expr(B).		{ A = ast->make<Ast::Else>(E, E, B); }
+case_default(A) ::= .				{ A = NO_NODE; }
+
+%type expr_list {PGParse::AstList}
+expr_list(A) ::= a_expr(B).			{ A = ast->list<Ast::ExprList>(B); }
+expr_list(A) ::= expr_list(B) COMMA a_expr(C).	{ A = ast->append(B, C); }
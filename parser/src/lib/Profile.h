@@ -0,0 +1,186 @@
+#if !defined (PGPARSE_PROFILE_H)
+#define PGPARSE_PROFILE_H
+
+/**
+ * Per-rule parse statistics, compiled in only when PGPARSE_PROFILE is
+ * defined.  Otherwise the macros below expand to nothing, and the rules
+ * are exactly as they'd be without them.
+ *
+ * Each rule type gets its own counters: how often it was tried, how
+ * often that succeeded or failed, how many tokens it consumed when it
+ * succeeded, how many it gave back when it failed part way, and the
+ * time spent in it (including the rules it called).  Memoized results
+ * that are reused don't count as attempts.
+ *
+ * The counters aren't synchronized, so profile one parse at a time.
+ */
+
+#if defined(PGPARSE_PROFILE)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace PGParse {
+
+struct RuleProfile
+{
+	std::string (*rule)(int);
+	uint64_t attempts;
+	uint64_t successes;
+	uint64_t failures;
+	uint64_t consumed;
+	uint64_t backtracked;
+	uint64_t nanoseconds;
+};
+
+class Profiler
+{
+private:
+	struct Registry
+	{
+		std::mutex mutex;
+		std::vector<RuleProfile *> rules;
+	};
+
+	static Registry&
+	registry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	static bool
+	slower(const RuleProfile *a, const RuleProfile *b)
+	{
+		return a->nanoseconds > b->nanoseconds;
+	}
+
+public:
+	template <class RULE>
+	static RuleProfile&
+	rule()
+	{
+		static RuleProfile *profile = add(&RULE::ruleString);
+		return *profile;
+	}
+
+	static RuleProfile *
+	add(std::string (*rule)(int))
+	{
+		RuleProfile *profile = new RuleProfile();
+		profile->rule = rule;
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		r.rules.push_back(profile);
+		return profile;
+	}
+
+	/**
+	 * Write a line per rule that was tried, slowest first.
+	 */
+	static void
+	report(std::ostream& out)
+	{
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		std::vector<RuleProfile *> rules(r.rules);
+		std::sort(rules.begin(), rules.end(), &slower);
+		out << "      ms   attempts  successes   failures   consumed backtracked  rule\n";
+		for (std::size_t i = 0; i < rules.size(); i ++) {
+			const RuleProfile& p = *rules[i];
+			if (!p.attempts) {
+				continue;
+			}
+			char line[128];
+			std::snprintf(
+				line, sizeof(line), "%8.3f %10llu %10llu %10llu %10llu %11llu  ",
+				p.nanoseconds / 1e6,
+				(unsigned long long)p.attempts,
+				(unsigned long long)p.successes,
+				(unsigned long long)p.failures,
+				(unsigned long long)p.consumed,
+				(unsigned long long)p.backtracked
+			);
+			out << line << p.rule(0) << "\n";
+		}
+	}
+
+	static void
+	reset()
+	{
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		for (std::size_t i = 0; i < r.rules.size(); i ++) {
+			std::string (*rule)(int) = r.rules[i]->rule;
+			*r.rules[i] = RuleProfile();
+			r.rules[i]->rule = rule;
+		}
+	}
+};
+
+/**
+ * Times one attempt at a rule, from construction to finish().
+ */
+class ProfileScope
+{
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	RuleProfile& profile_;
+	std::size_t start_;
+	Clock::time_point time_;
+
+public:
+	ProfileScope(RuleProfile& profile, std::size_t start)
+		: profile_(profile), start_(start), time_(Clock::now())
+	{
+		profile_.attempts ++;
+	}
+
+	// A rule that failed after getting as far as 'reached'.
+	//
+	void
+	backtrack(std::size_t reached)
+	{
+		profile_.backtracked += reached - start_;
+	}
+
+	void
+	finish(bool success, std::size_t end)
+	{
+		if (success) {
+			profile_.successes ++;
+			profile_.consumed += end - start_;
+		} else {
+			profile_.failures ++;
+		}
+		profile_.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+			Clock::now() - time_
+		).count();
+	}
+};
+
+} // PGParse
+
+#define PGPARSE_PROFILE_START(RULE, begin) \
+	PGParse::ProfileScope profile_scope_(PGParse::Profiler::rule<RULE>(), (begin).index())
+#define PGPARSE_PROFILE_BACKTRACK(reached) \
+	profile_scope_.backtrack((reached).index())
+#define PGPARSE_PROFILE_FINISH(success, begin) \
+	profile_scope_.finish((success), (begin).index())
+
+#else
+
+#define PGPARSE_PROFILE_START(RULE, begin)
+#define PGPARSE_PROFILE_BACKTRACK(reached)
+#define PGPARSE_PROFILE_FINISH(success, begin)
+
+#endif // PGPARSE_PROFILE
+
+#endif // PGPARSE_PROFILE_H
@@ -0,0 +1,287 @@
+#if !defined (PGPARSE_PUSH_PARSER_H)
+#define PGPARSE_PUSH_PARSER_H
+
+#include "Node.h"
+#include "StatementStream.h"
+
+namespace PGParse {
+
+/**
+ * Parses statements from tokens that arrive a few at a time, as they
+ * would from a connection, instead of from a complete token list.
+ *
+ * Each call to push() hands over one token and says what the parser
+ * can tell so far:
+ *
+ *   NEED_MORE	The statement isn't finished yet.
+ *   READY	A statement just finished and parsed; see statement().
+ *   FAILED	The statement can't parse, however it goes on; see
+ *		error().
+ *
+ * A statement ends at a semi-colon outside parentheses, the same place
+ * StatementStream resynchronizes, or at finish().  The semi-colon isn't
+ * part of the statement, so STATEMENT is a rule like Grammar::Stmt that
+ * doesn't end with one, and a semi-colon with nothing before it is
+ * ignored.  The rest of a failed statement is skipped, up to the
+ * semi-colon, with push() returning NEED_MORE.
+ *
+ * Tokens are parsed as they arrive, by a ResumableParse of STATEMENT
+ * that stops where it needs the next token and goes on from there when
+ * it comes, building the statement's nodes as it goes.  So push() does
+ * the work for its own token, not for the statement so far, and
+ * FAILED comes with the first token that no rule can go on with, or
+ * with one left over once STATEMENT is done.  By the semi-colon there's
+ * at most the last rule or two to finish.
+ *
+ * The parser keeps its own copy of the statement's tokens, so their
+ * offsets still refer to the caller's input, but literal values must be
+ * looked up in the caller's TokenList.  Nodes from statement() and the
+ * iterators in error() point into the parser, and are only valid until
+ * the next push().
+ */
+template <class STATEMENT>
+class PushParser
+{
+public:
+	enum State
+	{
+		NEED_MORE,
+		READY,
+		FAILED
+	};
+
+private:
+	int filter_;
+	TokenList tokens_;
+	int depth_;
+	bool skipping_;
+	bool finished_;
+	ParseContext context_;
+	ResumableParse parse_;
+	STATEMENT *statement_;
+	ParseError error_;
+
+	PushParser(const PushParser&);
+	PushParser& operator=(const PushParser&);
+
+	void
+	start()
+	{
+		tokens_.clear();
+		context_.clear();
+		parse_.start<STATEMENT>();
+		depth_ = 0;
+		skipping_ = false;
+		finished_ = false;
+		statement_ = 0;
+	}
+
+	// Take the parse as far as the tokens so far go, 'ended' saying
+	// whether there are any more in the statement.  Once STATEMENT is
+	// done it has to have taken all of them.
+	//
+	State
+	advance(bool ended)
+	{
+		if (!parse_.run(ended)) {
+			return NEED_MORE;
+		}
+		if (parse_.result() && parse_.position() == tokens_.size()) {
+			if (!ended) {
+				return NEED_MORE;
+			}
+			statement_ = static_cast<STATEMENT *>(parse_.result());
+			return READY;
+		}
+		MatchState state = parse_.state();
+		state.fail(tokens_.at(parse_.position()));
+		ParseError error = { tokens_.begin(), tokens_.end(), state.furthest };
+		error_ = error;
+		skipping_ = true;
+		return FAILED;
+	}
+
+public:
+	/**
+	 * Tokens with any of the 'filter' category flags, such as
+	 * comments and white space, are dropped as they arrive.
+	 */
+	explicit
+	PushParser(int filter = TOKEN_IS_IGNORED)
+		: filter_(filter), tokens_(), depth_(0), skipping_(false), finished_(false),
+		context_(), parse_(context_, tokens_), statement_(0), error_()
+	{
+		parse_.start<STATEMENT>();
+	}
+
+	State
+	push(const Token& token)
+	{
+		if (finished_) {
+			start();
+		}
+		if (token.is(filter_)) {
+			return NEED_MORE;
+		}
+		TokenId id = token.id();
+		if (id == OPEN_PAREN_T) {
+			depth_ ++;
+		} else if (id == CLOSE_PAREN_T) {
+			if (depth_ > 0) {
+				depth_ --;
+			}
+		} else if (id == SEMI_COLON_T && depth_ == 0) {
+			finished_ = true;
+			if (skipping_ || tokens_.empty()) {
+				return NEED_MORE;
+			}
+			return advance(true);
+		}
+		// What's left of a failed statement is only counted.
+		if (skipping_) {
+			return NEED_MORE;
+		}
+		tokens_.push_back(token);
+		return advance(false);
+	}
+
+	/**
+	 * The input has ended.  Finish whatever statement was left without
+	 * a semi-colon, returning READY or FAILED, or NEED_MORE if there
+	 * wasn't one.
+	 */
+	State
+	finish()
+	{
+		if (finished_ || skipping_ || tokens_.empty()) {
+			finished_ = true;
+			return NEED_MORE;
+		}
+		finished_ = true;
+		return advance(true);
+	}
+
+	// The statement that push() or finish() just returned READY for.
+	//
+	STATEMENT *
+	statement() const
+	{
+		return statement_;
+	}
+
+	// The tokens that didn't parse when push() or finish() returned
+	// FAILED.  An early failure only covers the tokens up to then.
+	//
+	const ParseError&
+	error() const
+	{
+		return error_;
+	}
+
+	// The tokens of the statement in progress, or of the one just
+	// finished, without its semi-colon.  For a statement that failed
+	// early, only the tokens up to the one it failed with.
+	//
+	const TokenList&
+	tokens() const
+	{
+		return tokens_;
+	}
+};
+
+/**
+ * Parses statements as the scanner finds their tokens, without a token
+ * list for the whole script:
+ *
+ *	StatementSink<Grammar::Stmt> sink;
+ *	std::ifstream in(path);
+ *	scanner.scan(in, sink);
+ *	sink.finish();
+ *
+ * It's a PushParser fed by the scanner, so it only ever holds the
+ * tokens and nodes of the statement in progress.  Scanning a stream,
+ * the scanner only holds a chunk of the script and the token it's on,
+ * so memory is bounded by the largest statement however long the
+ * script is.  scan(bytes, length, sink) works too, but the whole script
+ * is in memory then, twice over, since flex scans a copy of it.
+ *
+ * statement() is called for each statement that parses, and error()
+ * for each that doesn't, with the same lifetimes as PushParser's.
+ * Literal values aren't kept, since the scanner only has them while it
+ * hands over their tokens.
+ */
+template <class STATEMENT>
+class StatementSink : public TokenSink
+{
+private:
+	PushParser<STATEMENT> parser_;
+	std::size_t statements_;
+	std::size_t accepted_;
+
+	StatementSink(const StatementSink&);
+	StatementSink& operator=(const StatementSink&);
+
+	void
+	handle(typename PushParser<STATEMENT>::State state)
+	{
+		if (state == PushParser<STATEMENT>::READY) {
+			statements_ ++;
+			accepted_ ++;
+			statement(*parser_.statement());
+		} else if (state == PushParser<STATEMENT>::FAILED) {
+			statements_ ++;
+			error(parser_.error());
+		}
+	}
+
+protected:
+	virtual void
+	statement(STATEMENT& statement)
+	{}
+
+	virtual void
+	error(const ParseError& error)
+	{}
+
+public:
+	explicit
+	StatementSink(int filter = TOKEN_IS_IGNORED)
+		: parser_(filter), statements_(0), accepted_(0)
+	{}
+
+	void
+	token(const Token& token, std::size_t index)
+	{
+		handle(parser_.push(token));
+	}
+
+	// End the last statement, if it had no semi-colon.
+	//
+	void
+	finish()
+	{
+		handle(parser_.finish());
+	}
+
+	const PushParser<STATEMENT>&
+	parser() const
+	{
+		return parser_;
+	}
+
+	std::size_t
+	statements() const
+	{
+		return statements_;
+	}
+
+	std::size_t
+	accepted() const
+	{
+		return accepted_;
+	}
+};
+
+} // PGParse
+
+#endif // PGPARSE_PUSH_PARSER_H
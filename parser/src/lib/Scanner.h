@@ -2,26 +2,70 @@
 #define PGPARSE_SCANNER_H
 
 #include "flex.h"
+#include <iosfwd>
 #include <list>
+#include <vector>
 
 #include "Token.h"
 
 namespace PGParse {
 
 struct ScannerState;
+struct ScannerLane;
+
+/**
+ * The tokens of one input of a batch, as indexes into the token list.
+ */
+struct TokenRange
+{
+	std::size_t begin;
+	std::size_t end;
+};
 
 class Scanner
 {
 private:
 	ScannerState *scanner_state_;
 	TokenList tokens_;
+	std::vector<char> batch_buffer_;
+	std::vector<char *> batch_inputs_;
+	std::vector<ScannerLane *> lanes_;
+	std::size_t batch_lanes_;
+
+	void reserveTokens(std::size_t bytes);
+	void scanPadded(char *input, std::size_t length, TokenRange& range);
+	void scanInterleaved(
+		char *const *inputs,
+		const std::size_t *lengths,
+		std::size_t count,
+		std::vector<TokenRange>& ranges
+	);
 public:
 	Scanner();
 	~Scanner();
 	void scan(const char *bytes, std::size_t len);
+	void scan(const char *bytes, std::size_t len, TokenSink& sink);
+	void scan(std::istream& in, TokenSink& sink);
+	void setStandardConformingStrings(bool on);
+	void setDeferKeywords(bool on);
+	void setBatchLanes(std::size_t lanes);
+	void scanBatch(
+		const char *const *inputs,
+		const std::size_t *lengths,
+		std::size_t count,
+		std::vector<TokenRange>& ranges
+	);
+	void scanBatchInPlace(
+		char *const *inputs,
+		const std::size_t *lengths,
+		std::size_t count,
+		std::vector<TokenRange>& ranges
+	);
 	
 	TokenList::const_iterator tokensBegin(int filter = 0) const { return tokens_.begin(filter); }
 	TokenList::const_iterator tokensEnd()   const { return tokens_.end(); }
+	TokenValue value(const Token& token)    const { return tokens_.value(token); }
+	const TokenList& tokens()               const { return tokens_; }
 };
 
 }
@@ -0,0 +1,168 @@
+#if !defined (PGPARSE_STATEMENT_STREAM_H)
+#define PGPARSE_STATEMENT_STREAM_H
+
+#include "Node.h"
+#include <vector>
+
+namespace PGParse {
+
+/**
+ * A stretch of input that didn't parse as a statement.  'failure' is
+ * the furthest token any rule got to before failing, which is usually
+ * where the mistake is.
+ */
+struct ParseError
+{
+	token_iterator begin;
+	token_iterator end;
+	token_iterator failure;
+};
+
+/**
+ * Skip to just past the next semi-colon that isn't inside parentheses,
+ * or to 'end' if there isn't one.  This is where the next statement
+ * should start after one that didn't parse.
+ */
+inline token_iterator
+resynchronize(token_iterator begin, const token_iterator& end)
+{
+	int depth = 0;
+	while (begin != end) {
+		TokenId id = begin->id();
+		begin ++;
+		if (id == OPEN_PAREN_T) {
+			depth ++;
+		} else if (id == CLOSE_PAREN_T) {
+			if (depth > 0) {
+				depth --;
+			}
+		} else if (id == SEMI_COLON_T && depth == 0) {
+			break;
+		}
+	}
+	return begin;
+}
+
+/**
+ * Try to parse a STATEMENT at 'begin'.  If it doesn't parse, record
+ * the error, skip past it and try again.  Returns 0 only once the
+ * input is used up.
+ */
+template <class STATEMENT>
+STATEMENT *
+parseRecovering(
+	token_iterator& begin, 
+	const token_iterator& end, 
+	ParseContext& context, 
+	std::vector<ParseError>& errors
+)
+{
+	while (begin != end) {
+		token_iterator start = begin;
+		STATEMENT *statement = STATEMENT::parse(begin, end, context);
+		// A statement that matches nothing would never get
+		// anywhere, so it counts as an error too.
+		if (statement && begin != start) {
+			return statement;
+		}
+		begin = start;
+		MatchState state;
+		STATEMENT::match(begin, end, state);
+		state.fail(start);
+		ParseError error = { start, resynchronize(start, end), state.furthest };
+		errors.push_back(error);
+		begin = error.end;
+	}
+	return 0;
+}
+
+/**
+ * Parse every statement from 'begin' to 'end' in one pass, skipping
+ * the ones that don't parse.  The statements that did are added to
+ * 'statements' and the rest to 'errors'.
+ */
+template <class STATEMENT>
+void
+parseStatements(
+	token_iterator begin, 
+	const token_iterator& end, 
+	ParseContext& context, 
+	std::vector<STATEMENT *>& statements, 
+	std::vector<ParseError>& errors
+)
+{
+	while (STATEMENT *statement = parseRecovering<STATEMENT>(begin, end, context, errors)) {
+		statements.push_back(statement);
+	}
+}
+
+/**
+ * Parses a script one statement at a time.
+ *
+ * Each call to next() gives back everything allocated for the previous
+ * statement (its nodes and memo entries) before parsing the next one,
+ * so however long the script is, the parser only ever holds the nodes
+ * of one statement.  The arena and memo table keep their memory between
+ * statements, so after the largest statement nothing more is
+ * allocated.  The tokens are another matter: they're the whole
+ * script's, scanned beforehand.  To parse a script without holding it
+ * or its tokens, scan it as a stream into a StatementSink, in
+ * PushParser.h.
+ *
+ * Statements that don't parse are skipped up to the next semi-colon
+ * outside parentheses, and recorded in errors().
+ *
+ * A node returned by next() is only valid until the following call.
+ */
+template <class STATEMENT>
+class StatementStream
+{
+private:
+	token_iterator begin_;
+	token_iterator end_;
+	ParseContext context_;
+	std::vector<ParseError> errors_;
+
+	StatementStream(const StatementStream&);
+	StatementStream& operator=(const StatementStream&);
+
+public:
+	StatementStream(token_iterator begin, token_iterator end)
+		: begin_(begin), end_(end), context_(), errors_()
+	{}
+
+	/**
+	 * Parse the next statement that parses, or return 0 at the end
+	 * of the input.
+	 */
+	STATEMENT *
+	next()
+	{
+		context_.clear();
+		return parseRecovering<STATEMENT>(begin_, end_, context_, errors_);
+	}
+
+	const std::vector<ParseError>&
+	errors() const
+	{
+		return errors_;
+	}
+
+	// Where the next statement starts.
+	//
+	const token_iterator&
+	position() const
+	{
+		return begin_;
+	}
+
+	bool
+	done() const
+	{
+		return begin_ == end_;
+	}
+};
+
+} // PGParse
+
+#endif // PGPARSE_STATEMENT_STREAM_H
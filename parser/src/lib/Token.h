@@ -2,6 +2,7 @@
 #define PGPARSE_TOKEN_H
 
 #include <vector>
+#include <string>
 #include <cstddef>
 #include <boost/iterator/iterator_facade.hpp>
 
@@ -14,10 +15,17 @@ class Token
 private:
 	std::size_t offset_;
 	std::size_t length_;
-	TokenId id_;
+	mutable TokenId id_;
+	unsigned value_;
 public:
-	Token(std::size_t offset, std::size_t length, TokenId id)
-		: offset_(offset), length_(length), id_(id)
+	// Most tokens are fully described by their position in the
+	// input.  Literals that need decoding (escapes, etc.) carry
+	// an index into the value table of their TokenList.
+	//
+	static const unsigned NO_VALUE = ~0u;
+
+	Token(std::size_t offset, std::size_t length, TokenId id, unsigned value = NO_VALUE)
+		: offset_(offset), length_(length), id_(id), value_(value)
 	{}
 
 	std::size_t
@@ -38,6 +46,33 @@ public:
 		return id_;
 	}
 
+	/**
+	 * In deferred keyword mode the scanner emits WORD_T for anything
+	 * that might be a keyword.  This works out which it is, and
+	 * remembers the answer in the token.  'input' is the buffer that
+	 * the token offsets refer to.
+	 */
+	TokenId
+	classify(const char *input) const
+	{
+		if (id_ == WORD_T) {
+			id_ = classifyWord(input + offset_, length_);
+		}
+		return id_;
+	}
+
+	unsigned
+	value() const
+	{
+		return value_;
+	}
+
+	bool
+	hasValue() const
+	{
+		return value_ != NO_VALUE;
+	}
+
 	int 
 	category() const
 	{
@@ -63,13 +98,121 @@ public:
 	}
 };
 
+/**
+ * The decoded value of a literal, pointing into the value buffer of
+ * the TokenList that owns the token.  Only valid until the list is
+ * modified.
+ */
+struct TokenValue
+{
+	const char *bytes;
+	std::size_t length;
+};
+
 //typedef std::vector<Token> TokenList;
 
 typedef std::vector<Token> TokenListBase;
 
 class TokenList : public TokenListBase
 {
+private:
+	struct ValueRange
+	{
+		std::size_t offset;
+		std::size_t length;
+	};
+
+	// All decoded values are appended to a single buffer, so
+	// decoding a literal never costs more than an occasional
+	// reallocation.
+	//
+	std::string value_bytes_;
+	std::vector<ValueRange> value_ranges_;
+
 public:
+	std::string&
+	valueBytes()
+	{
+		return value_bytes_;
+	}
+
+	/**
+	 * Register everything appended to valueBytes() since 'begin' as
+	 * a new value, and return the index to store in the token.
+	 */
+	unsigned
+	addValue(std::size_t begin)
+	{
+		ValueRange range = { begin, value_bytes_.size() - begin };
+		value_ranges_.push_back(range);
+		return value_ranges_.size() - 1;
+	}
+
+	// How many values there are, for truncateValues().
+	//
+	std::size_t
+	valueCount() const
+	{
+		return value_ranges_.size();
+	}
+
+	/**
+	 * Forget every value after the first 'count', keeping the memory
+	 * for the next ones.
+	 */
+	void
+	truncateValues(std::size_t count)
+	{
+		if (count < value_ranges_.size()) {
+			value_bytes_.resize(value_ranges_[count].offset);
+			value_ranges_.resize(count);
+		}
+	}
+
+	/**
+	 * Add the tokens of 'other' to the end of this list, bringing
+	 * their values along.
+	 */
+	void
+	append(const TokenList& other)
+	{
+		if (other.value_ranges_.empty()) {
+			insert(TokenListBase::end(), other.TokenListBase::begin(), other.TokenListBase::end());
+			return;
+		}
+		unsigned values = value_ranges_.size();
+		std::size_t bytes = value_bytes_.size();
+		value_bytes_.append(other.value_bytes_);
+		for (std::size_t i = 0; i < other.value_ranges_.size(); i ++) {
+			ValueRange range = other.value_ranges_[i];
+			range.offset += bytes;
+			value_ranges_.push_back(range);
+		}
+		for (TokenListBase::const_iterator i = other.TokenListBase::begin(); i != other.TokenListBase::end(); i ++) {
+			push_back(Token(
+				i->offset(), i->length(), i->id(),
+				i->hasValue() ? i->value() + values : Token::NO_VALUE
+			));
+		}
+	}
+
+	TokenValue
+	value(const Token& token) const
+	{
+		TokenValue ret = { 0, 0 };
+		if (token.hasValue()) {
+			const ValueRange& range = value_ranges_[token.value()];
+			ret.bytes = value_bytes_.data() + range.offset;
+			ret.length = range.length;
+		}
+		return ret;
+	}
+
+	/**
+	 * Iterators hold the list and an index rather than a pointer into
+	 * the vector, so they stay valid as tokens are added: a parser can
+	 * keep them in its nodes while the rest of a statement arrives.
+	 */
 	class const_iterator : public boost::iterator_facade<
 		const_iterator,
 		Token const,
@@ -78,7 +221,7 @@ public:
 	{
 	public:
 		const_iterator()
-		: 	tokens_(0), flag_filter_(0), iterator_()
+		: 	tokens_(0), flag_filter_(0), index_(0)
 		{
 		}
 
@@ -86,7 +229,7 @@ public:
 		const_iterator(const TokenList* tokens, int flag_filter)
 		: 	tokens_(tokens), 
 			flag_filter_(flag_filter),
-			iterator_(tokens->TokenListBase::begin())
+			index_(0)
 		{
 		}
 
@@ -94,9 +237,25 @@ public:
 		const_iterator(const TokenList* tokens)
 		: 	tokens_(tokens), 
 			flag_filter_(0),
-			iterator_(tokens->TokenListBase::end())
+			index_(tokens->size())
 		{
 		}
+
+		const_iterator(const TokenList* tokens, int flag_filter, std::size_t index)
+		: 	tokens_(tokens), 
+			flag_filter_(flag_filter),
+			index_(index)
+		{
+		}
+
+		// Position of the current token in the underlying list,
+		// counting filtered-out tokens too.
+		//
+		std::size_t
+		index() const
+		{
+			return index_;
+		}
 		
 	private:
 		friend class boost::iterator_core_access;
@@ -105,25 +264,25 @@ public:
 		increment()
 		{
 			do {
-				iterator_ ++;
-			} while (iterator_!= tokens_->TokenListBase::end() && iterator_->is(flag_filter_));
+				index_ ++;
+			} while (index_ < tokens_->size() && (*tokens_)[index_].is(flag_filter_));
 		}
 		
 		bool
 		equal(const_iterator const& other) const
 		{
-			return iterator_ == other.iterator_;
+			return index_ == other.index_;
 		}
 		
 		const Token&
 		dereference() const
 		{
-			return *iterator_;
+			return (*tokens_)[index_];
 		}
 		
 		const TokenList* tokens_;
 		int flag_filter_;
-		TokenListBase::const_iterator iterator_;
+		std::size_t index_;
 	};
 	
 	const_iterator 
@@ -137,6 +296,27 @@ public:
 	{
 		return const_iterator(this);
 	}
+
+	// An iterator at the index'th token, which should pass 'filter'.
+	//
+	const_iterator
+	at(std::size_t index, int filter = 0) const
+	{
+		return const_iterator(this, filter, index);
+	}
+};
+
+/**
+ * Takes tokens from the scanner as it finds them, for a consumer like
+ * a parser that only needs to see each one once and has no use for
+ * the token list.  'index' is the token's place in the input, counting
+ * ignored tokens, so it's what its index in a TokenList would be.
+ */
+class TokenSink
+{
+public:
+	virtual ~TokenSink() {}
+	virtual void token(const Token& token, std::size_t index) = 0;
 };
 
 }
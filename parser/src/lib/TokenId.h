@@ -1,6 +1,7 @@
 #if !defined (TOKEN_ID_H)
 #define TOKEN_ID_H
 
+#include <cstddef>
 #include <string>
 
 namespace PGParse {
@@ -46,6 +47,7 @@ enum TokenId {
 	IDENTIFIER_T,
 	DQ_IDENTIFIER_T,
 	UNICODE_IDENTIFIER_T,
+	WORD_T,
 	WHITESPACE_T,
 	COMMENT_T,
 	TYPECAST_T,
@@ -89,6 +91,8 @@ enum TokenId {
 	MALFORMED_DOLLAR_QUOTE_E,
 	ZERO_LENGTH_QUOTED_IDENTIFIER_E,
 	ZERO_LENGTH_UNICODE_IDENTIFIER_E,
+	INVALID_BIT_STRING_E,
+	INVALID_HEX_STRING_E,
 	ERROR_SENTINAL,
 	
 	// All done.
@@ -143,6 +147,7 @@ TokenId		keywordToId	(
 			TokenId from = TokenId(INVALID + 1),
 			TokenId to = KW_SENTINAL
 		);
+TokenId		classifyWord	(const char *text, std::size_t length);
 const char * 	idString	(TokenId id);
 std::string	categoryString	(CategoryFlags category_flags);
 int 		lemonId		(TokenId id);
@@ -0,0 +1,103 @@
+#if !defined (PGPARSE_WRITER_H)
+#define PGPARSE_WRITER_H
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace PGParse {
+
+/**
+ * Buffered output to a stream or a string.
+ *
+ * Writes go to a fixed buffer that's passed on when it fills, so
+ * producing a large dump costs one copy per byte and no allocation
+ * beyond what the target itself does.  Whatever is still buffered is
+ * passed on by flush() or the destructor.
+ */
+class Writer
+{
+private:
+	static const std::size_t BUFFER_SIZE = 8192;
+
+	std::ostream *stream_;
+	std::string *string_;
+	std::size_t used_;
+	char buffer_[BUFFER_SIZE];
+
+	Writer(const Writer&);
+	Writer& operator=(const Writer&);
+
+public:
+	explicit
+	Writer(std::ostream& stream) : stream_(&stream), string_(0), used_(0)
+	{}
+
+	explicit
+	Writer(std::string& string) : stream_(0), string_(&string), used_(0)
+	{}
+
+	~Writer()
+	{
+		flush();
+	}
+
+	void
+	flush()
+	{
+		if (stream_) {
+			stream_->write(buffer_, used_);
+		} else {
+			string_->append(buffer_, used_);
+		}
+		used_ = 0;
+	}
+
+	void
+	write(const char *bytes, std::size_t length)
+	{
+		if (BUFFER_SIZE - used_ < length) {
+			flush();
+			if (length > BUFFER_SIZE) {
+				if (stream_) {
+					stream_->write(bytes, length);
+				} else {
+					string_->append(bytes, length);
+				}
+				return;
+			}
+		}
+		std::memcpy(buffer_ + used_, bytes, length);
+		used_ += length;
+	}
+
+	void
+	write(const char *s)
+	{
+		write(s, std::strlen(s));
+	}
+
+	void
+	put(char c)
+	{
+		if (used_ == BUFFER_SIZE) {
+			flush();
+		}
+		buffer_[used_ ++] = c;
+	}
+
+	// 'count' copies of 'c', for indentation.
+	//
+	void
+	repeat(char c, std::size_t count)
+	{
+		while (count --) {
+			put(c);
+		}
+	}
+};
+
+} // PGParse
+
+#endif // PGPARSE_WRITER_H